@@ -1,22 +1,39 @@
 #include "LP_reader.h"
+#include "MPS_reader.h"
 
-void release_memory(int       m,
-                    double ** A,
+#include <ctype.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Longest number handed to strtod, see parse_number. */
+#define MAX_NUMBER_LENGTH 128
+
+/* Position in the text of an LP file. The text is not
+   NUL-terminated: it ends at end. */
+typedef struct {
+   const char * p;            /* Next character to parse */
+   const char * end;
+   const char * line_start;   /* Start of the line p is on */
+   int          line;
+} Parser;
+
+/* Powers of ten that are exact as doubles. */
+const double exact_powers_of_ten[] = {
+   1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+void release_memory(double ** A,
                     double *  b,
                     double *  c)
 {
    if (A) {
-      int i;
-      for (i = 0; i < m; i++) {
-         if (A[i]) {
-            free(A[i]);
-         } else {
-            /* If A[i] is NULL, then the next entries won't have been
-               allocated and their pointer values will be undefined. */
-            break;
-         }
-      }
-      free (A);
+      /* All rows are stored in the block A[0] points to. */
+      free(A[0]);
+      free(A);
    }
 
    if (b) {
@@ -27,14 +44,508 @@ void release_memory(int       m,
    }
 }
 
+void skip_space(Parser * ps)
+{
+   while (ps->p < ps->end && isspace((unsigned char) *ps->p)) {
+      if (*ps->p == '\n') {
+         ps->line++;
+         ps->line_start = ps->p + 1;
+      }
+      ps->p++;
+   }
+}
+
+int parse_error(const char * filename, const Parser * ps,
+                const char * message)
+{
+   fprintf(stderr, "%s:%d:%d: %s.\n", filename, ps->line,
+           (int) (ps->p - ps->line_start) + 1, message);
+   return EXIT_FAILURE;
+}
+
+/* Parse the next number into *x and return 1, or leave ps at the
+   start of the offending text and return 0. Numbers with at most
+   15 significant digits and a small exponent, which is nearly all
+   of them, are converted exactly by a single multiplication or
+   division. Anything else is left to strtod, so the result is
+   always the same as that of strtod.
+*/
+int parse_number(Parser * ps, double * x)
+{
+   const char *       s;
+   const char *       start;
+   char               buffer[MAX_NUMBER_LENGTH];
+   char *             stop;
+   unsigned long long mantissa = 0;
+   int                digits = 0;
+   int                any_digits = 0;
+   int                exponent = 0;
+   int                e = 0;
+   int                negative = 0;
+   int                negative_e = 0;
+
+   skip_space(ps);
+   start = s = ps->p;
+   if (s < ps->end && (*s == '-' || *s == '+')) {
+      negative = (*s == '-');
+      s++;
+   }
+   for (; s < ps->end && isdigit((unsigned char) *s); s++) {
+      any_digits = 1;
+      if (mantissa || *s != '0') {
+         if (++digits <= 19) {
+            mantissa = 10 * mantissa + (*s - '0');
+         } else {
+            exponent++;
+         }
+      }
+   }
+   if (s < ps->end && *s == '.') {
+      for (s++; s < ps->end && isdigit((unsigned char) *s); s++) {
+         any_digits = 1;
+         if (mantissa || *s != '0') {
+            if (++digits <= 19) {
+               mantissa = 10 * mantissa + (*s - '0');
+               exponent--;
+            }
+         } else {
+            exponent--;
+         }
+      }
+   }
+   if (any_digits && s < ps->end && (*s == 'e' || *s == 'E')) {
+      s++;
+      if (s < ps->end && (*s == '-' || *s == '+')) {
+         negative_e = (*s == '-');
+         s++;
+      }
+      if (!(s < ps->end && isdigit((unsigned char) *s))) {
+         any_digits = 0;
+      }
+      for (; s < ps->end && isdigit((unsigned char) *s); s++) {
+         if (e < 10000) {
+            e = 10 * e + (*s - '0');
+         }
+      }
+      exponent += (negative_e ? -e : e);
+   }
+
+   if (any_digits && digits <= 15 && exponent >= -22 && exponent <= 22 &&
+       (s == ps->end || isspace((unsigned char) *s))) {
+      *x = (double) mantissa;
+      if (exponent < 0) {
+         *x /= exact_powers_of_ten[-exponent];
+      } else {
+         *x *= exact_powers_of_ten[exponent];
+      }
+      if (negative) {
+         *x = -*x;
+      }
+      ps->p = s;
+      return 1;
+   }
+
+   /* Leave the rest to strtod, on a NUL-terminated copy. */
+   for (s = start; s < ps->end && !isspace((unsigned char) *s); s++) {
+      if (s - start == MAX_NUMBER_LENGTH - 1) {
+         return 0;
+      }
+   }
+   if (s == start) {
+      return 0;
+   }
+   memcpy(buffer, start, s - start);
+   buffer[s - start] = '\0';
+   *x = strtod(buffer, &stop);
+   if (stop != buffer + (s - start)) {
+      return 0;
+   }
+   ps->p = s;
+   return 1;
+}
+
+/* Parse the next number as a size, see parse_number. */
+int parse_size(Parser * ps, int * size)
+{
+   Parser start;
+   double x;
+
+   skip_space(ps);
+   start = *ps;
+   if (!parse_number(ps, &x) || x < 0 || x > 1e9 || x != (int) x) {
+      *ps = start;
+      return 0;
+   }
+   *size = (int) x;
+   return 1;
+}
+
+/* Parse count numbers into x. */
+int parse_numbers(const char * filename, Parser * ps,
+                  double * x, size_t count)
+{
+   size_t k;
+
+   for (k = 0; k < count; k++) {
+      if (!parse_number(ps, x + k)) {
+         return parse_error(filename, ps, (ps->p == ps->end ?
+                            "unexpected end of file" : "expected a number"));
+      }
+   }
+   return EXIT_SUCCESS;
+}
+
+/* Return the contents of a file in *text, mapped if possible,
+   and its size in *size. Set *mapped to whether it is mapped;
+   if not, it has to be freed instead of unmapped. */
+int read_text(const char * filename, char ** text,
+              size_t * size, int * mapped)
+{
+   struct stat st;
+   size_t      capacity;
+   ssize_t     count;
+   int         fd;
+
+   if ((fd = open(filename, O_RDONLY)) < 0) {
+      fprintf(stderr, "Could not open \"%s\".\n", filename);
+      return EXIT_FAILURE;
+   }
+
+   *mapped = 0;
+   if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0) {
+      *size = st.st_size;
+      *text = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (*text != MAP_FAILED) {
+         madvise(*text, *size, MADV_SEQUENTIAL);
+         *mapped = 1;
+         close(fd);
+         return EXIT_SUCCESS;
+      }
+   }
+
+   /* Not a (non-empty) regular file, e.g. a pipe: read all of it. */
+   *size = 0;
+   capacity = 1 << 16;
+   *text = malloc(capacity);
+   while (*text && (count = read(fd, *text + *size, capacity - *size)) > 0) {
+      *size += count;
+      if (*size == capacity) {
+         capacity *= 2;
+         *text = realloc(*text, capacity);
+      }
+   }
+   close(fd);
+   if (!*text) {
+      fprintf(stderr, "Memory allocation failure.\n");
+      return EXIT_FAILURE;
+   }
+   return EXIT_SUCCESS;
+}
+
+/* Allocate A, b and c for an LP with m rows and n columns, with
+   the rows of A in one block, see read_LP. */
+int allocate_LP(int         m,
+                int         n,
+                double ***  A,
+                double **   b,
+                double **   c)
+{
+   int i;
+
+   if ((*A = (double**) calloc(m ? m : 1, sizeof(double*))) &&
+       ((*A)[0] = (double*) malloc(((size_t) m * n + 1) * sizeof(double))) &&
+       (*b = (double*)  malloc((m + 1) * sizeof(double)))  &&
+       (*c = (double*)  malloc((n + 1) * sizeof(double)))) {
+      for (i = 1; i < m; i++) {
+         (*A)[i] = (*A)[0] + (size_t) i * n;
+      }
+      return EXIT_SUCCESS;
+   }
+   fprintf(stderr, "Memory allocation failure.\n");
+   return EXIT_FAILURE;
+}
+
+/* Round offset up to a multiple of LP_BINARY_ALIGN. */
+size_t align_binary(size_t offset)
+{
+   return (offset + LP_BINARY_ALIGN - 1) / LP_BINARY_ALIGN * LP_BINARY_ALIGN;
+}
+
+/* Find where the blocks of a binary LP file with the given header
+   start: c, b, A (or col_start), row_index and values, and return
+   the size of the file. */
+size_t binary_layout(const LPBinaryHeader * header, size_t offset[5])
+{
+   size_t m   = header->m;
+   size_t n   = header->n;
+   size_t nnz = header->nnz;
+
+   offset[0] = align_binary(sizeof(LPBinaryHeader));
+   offset[1] = align_binary(offset[0] + n * sizeof(double));
+   offset[2] = align_binary(offset[1] + m * sizeof(double));
+   if (!header->sparse) {
+      offset[3] = offset[4] = offset[2] + m * n * sizeof(double);
+      return offset[3];
+   }
+   offset[3] = align_binary(offset[2] + (n + 1) * sizeof(unsigned int));
+   offset[4] = align_binary(offset[3] + nnz * sizeof(unsigned int));
+   return offset[4] + nnz * sizeof(double);
+}
+
+int is_LP_binary(const char * filename)
+{
+   char  magic[8];
+   FILE *fp;
+   int   result;
+
+   if (!(fp = fopen(filename, "rb"))) {
+      return 0;
+   }
+   result = (fread(magic, 1, 8, fp) == 8 && !memcmp(magic, LP_BINARY_MAGIC, 8));
+   fclose(fp);
+   return result;
+}
+
+/* Map a binary LP file and point lp into it, after checking that
+   the file is complete and the sparse structure is consistent,
+   so that users never read outside the mapping. */
+int map_LP_binary(const char * filename, LPBinary * lp)
+{
+   LPBinaryHeader header;
+   struct stat    st;
+   size_t         offset[5];
+   size_t         size;
+   char *         map;
+   int            fd;
+   int            j;
+   unsigned int   k;
+
+   memset(lp, 0, sizeof(LPBinary));
+   if ((fd = open(filename, O_RDONLY)) < 0) {
+      fprintf(stderr, "Could not open \"%s\".\n", filename);
+      return EXIT_FAILURE;
+   }
+   if (fstat(fd, &st) || read(fd, &header, sizeof(header)) != sizeof(header) ||
+       memcmp(header.magic, LP_BINARY_MAGIC, 8) || header.m < 0 || header.n < 0 ||
+       (size = binary_layout(&header, offset)) != (size_t) st.st_size) {
+      fprintf(stderr, "%s: not a valid binary LP file.\n", filename);
+      close(fd);
+      return EXIT_FAILURE;
+   }
+   map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (map == MAP_FAILED) {
+      fprintf(stderr, "Could not map \"%s\".\n", filename);
+      return EXIT_FAILURE;
+   }
+
+   lp->m = header.m;
+   lp->n = header.n;
+   lp->sparse = header.sparse;
+   lp->nnz = header.nnz;
+   lp->c = (const double *) (map + offset[0]);
+   lp->b = (const double *) (map + offset[1]);
+   lp->map = map;
+   lp->size = size;
+   if (!lp->sparse) {
+      lp->A = (const double *) (map + offset[2]);
+      return EXIT_SUCCESS;
+   }
+   lp->col_start = (const unsigned int *) (map + offset[2]);
+   lp->row_index = (const unsigned int *) (map + offset[3]);
+   lp->values = (const double *) (map + offset[4]);
+
+   if (lp->col_start[0] != 0 || lp->col_start[lp->n] != lp->nnz) {
+      j = -1;
+   } else {
+      for (j = 0; j < lp->n && lp->col_start[j] <= lp->col_start[j + 1]; j++);
+      for (k = 0; k < lp->nnz && lp->row_index[k] < (unsigned int) lp->m; k++);
+      if (k < lp->nnz) {
+         j = -1;
+      }
+   }
+   if (j != lp->n) {
+      fprintf(stderr, "%s: not a valid binary LP file.\n", filename);
+      unmap_LP_binary(lp);
+      return EXIT_FAILURE;
+   }
+   return EXIT_SUCCESS;
+}
+
+void unmap_LP_binary(LPBinary * lp)
+{
+   if (lp->map) {
+      munmap(lp->map, lp->size);
+   }
+   memset(lp, 0, sizeof(LPBinary));
+}
+
+/* Read a binary LP file like read_LP does a text file. */
+int read_LP_binary(const char * filename,
+                   int *        m,
+                   int *        n,
+                   double ***   A,
+                   double **    b,
+                   double **    c)
+{
+   LPBinary     lp;
+   int          j;
+   unsigned int k;
+
+   if (map_LP_binary(filename, &lp) != EXIT_SUCCESS) {
+      return EXIT_FAILURE;
+   }
+   *m = lp.m;
+   *n = lp.n;
+   if (allocate_LP(*m, *n, A, b, c) != EXIT_SUCCESS) {
+      release_memory(*A, *b, *c);
+      *A = NULL;
+      *b = NULL;
+      *c = NULL;
+      unmap_LP_binary(&lp);
+      return EXIT_FAILURE;
+   }
+
+   memcpy(*c, lp.c, *n * sizeof(double));
+   memcpy(*b, lp.b, *m * sizeof(double));
+   if (!lp.sparse) {
+      memcpy((*A)[0], lp.A, (size_t) *m * *n * sizeof(double));
+   } else {
+      memset((*A)[0], 0, (size_t) *m * *n * sizeof(double));
+      for (j = 0; j < *n; j++) {
+         for (k = lp.col_start[j]; k < lp.col_start[j + 1]; k++) {
+            (*A)[lp.row_index[k]][j] = lp.values[k];
+         }
+      }
+   }
+   unmap_LP_binary(&lp);
+   return EXIT_SUCCESS;
+}
+
+/* Read an MPS file like read_LP does a text file, see read_MPS. */
+int read_LP_MPS(const char * filename,
+                int *        m,
+                int *        n,
+                double ***   A,
+                double **    b,
+                double **    c)
+{
+   SparseLP lp;
+   int      result;
+
+   if (read_MPS(filename, 0, &lp) != EXIT_SUCCESS) {
+      return EXIT_FAILURE;
+   }
+   result = sparse_LP_to_dense(&lp, m, n, A, b, c);
+   free_sparse_LP(&lp);
+   return result;
+}
+
+/* Write zeros up to the given offset. */
+void pad_binary(FILE * fp, size_t offset)
+{
+   while ((size_t) ftell(fp) < offset) {
+      fputc(0, fp);
+   }
+}
+
+/* Write an LP to filename in the binary format. A is stored sparse
+   if that takes less space. */
+int write_LP_binary(const char * filename,
+                    int          m,
+                    int          n,
+                    double **    A,
+                    double *     b,
+                    double *     c)
+{
+   LPBinaryHeader header;
+   size_t         offset[5];
+   size_t         nnz = 0;
+   unsigned int   k;
+   int            i;
+   int            j;
+   FILE *         fp;
+
+   for (i = 0; i < m; i++) {
+      for (j = 0; j < n; j++) {
+         nnz += (A[i][j] != 0);
+      }
+   }
+   if (nnz > 0xffffffffUL) {
+      fprintf(stderr, "Too many non-zero entries.\n");
+      return EXIT_FAILURE;
+   }
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, LP_BINARY_MAGIC, 8);
+   header.m = m;
+   header.n = n;
+   header.nnz = nnz;
+   header.sparse = (nnz * (sizeof(double) + sizeof(unsigned int)) + (n + 1) * sizeof(unsigned int)
+                    < (size_t) m * n * sizeof(double));
+   binary_layout(&header, offset);
+
+   if (!(fp = fopen(filename, "wb"))) {
+      fprintf(stderr, "Could not open \"%s\".\n", filename);
+      return EXIT_FAILURE;
+   }
+   fwrite(&header, sizeof(header), 1, fp);
+   pad_binary(fp, offset[0]);
+   fwrite(c, sizeof(double), n, fp);
+   pad_binary(fp, offset[1]);
+   fwrite(b, sizeof(double), m, fp);
+   pad_binary(fp, offset[2]);
+   if (!header.sparse) {
+      for (i = 0; i < m; i++) {
+         fwrite(A[i], sizeof(double), n, fp);
+      }
+   } else {
+      /* Compressed sparse columns, see LPBinary. */
+      k = 0;
+      for (j = 0; j < n; j++) {
+         fwrite(&k, sizeof(unsigned int), 1, fp);
+         for (i = 0; i < m; i++) {
+            k += (A[i][j] != 0);
+         }
+      }
+      fwrite(&k, sizeof(unsigned int), 1, fp);
+      pad_binary(fp, offset[3]);
+      for (j = 0; j < n; j++) {
+         for (i = 0; i < m; i++) {
+            if (A[i][j] != 0) {
+               k = i;
+               fwrite(&k, sizeof(unsigned int), 1, fp);
+            }
+         }
+      }
+      pad_binary(fp, offset[4]);
+      for (j = 0; j < n; j++) {
+         for (i = 0; i < m; i++) {
+            if (A[i][j] != 0) {
+               fwrite(&A[i][j], sizeof(double), 1, fp);
+            }
+         }
+      }
+   }
+   if (fclose(fp)) {
+      fprintf(stderr, "Could not write \"%s\".\n", filename);
+      return EXIT_FAILURE;
+   }
+   return EXIT_SUCCESS;
+}
+
 /* The function reads an LP instance from filename. The file
    format is expected to be exactly as in the problem specification.
    On return, *m and *n will be the number of rows and columns,
    respectively; A, b and c will be the the matrix, right-hand side
    vector and objective function vector, respectively. Note that
    the order of the data in the input file is c, then b, then A.
+   The rows of A are stored one after the other in a single block,
+   starting at (*A)[0].
    Memory will be allocated for A, b and c; it is the caller's
-   responsibility to release the memory later.
+   responsibility to release the memory later, see release_memory.
+   Malformed input is reported with its line and column.
+   Binary LP files, see write_LP_binary, and MPS files, see
+   read_MPS, are read as well.
 */
 int read_LP(const char * filename,
             int *        m,
@@ -43,54 +554,61 @@ int read_LP(const char * filename,
             double **    b,
             double **    c)
 {
-   FILE *fp;
+   Parser ps;
+   char * text;
+   size_t size;
+   int    mapped;
+   int    result = EXIT_SUCCESS;
 
-   if (!(fp = fopen(filename, "r")))
-   {
-      fprintf(stderr, "Could not open \"%s\".\n", filename);
+   *A = NULL;
+   *b = NULL;
+   *c = NULL;
+   if (is_LP_binary(filename)) {
+      return read_LP_binary(filename, m, n, A, b, c);
+   }
+   if (is_MPS(filename)) {
+      return read_LP_MPS(filename, m, n, A, b, c);
+   }
+   if (read_text(filename, &text, &size, &mapped) != EXIT_SUCCESS) {
       return EXIT_FAILURE;
-   } else {
-      int i;
-      int j;
+   }
+   ps.p = ps.line_start = text;
+   ps.end = text + size;
+   ps.line = 1;
 
-      fscanf(fp, "%d %d\n", m, n);
-
-      /* Memory allocation. */
-      if ((*A = (double**) malloc(*m * sizeof(double*))) &&
-          (*b = (double*)  malloc(*m * sizeof(double)))  &&
-          (*c = (double*)  malloc(*n * sizeof(double)))) {
-         for (i = 0; i < *m; i++) {
-            if (!((*A)[i] = (double*) malloc(*n * sizeof(double)))) {
-               fprintf(stderr, "Memory allocation failure.\n");
-               release_memory(i - 1, *A, *b, *c);
-               fclose(fp);
-               return EXIT_FAILURE;
-            }
-         }
-      } else {
-         fprintf(stderr, "Memory allocation failure.\n");
-         release_memory(0, *A, *b, *c);
-         fclose(fp);
-         return EXIT_FAILURE;
-      }
+   if (!parse_size(&ps, m) || !parse_size(&ps, n)) {
+      result = parse_error(filename, &ps, "expected the number of rows and columns");
+   }
 
-      /* Copying the values into A, b and c. */
-      for (j = 0; j < *n; j++) {
-         fscanf(fp, "%lf", *c + j);
-      }
-      for (i = 0; i < *m; i++) {
-         fscanf(fp, "%lf", *b + i);
-      }
-      for (i = 0; i < *m; i++) {
-         for (j = 0; j < *n; j++) {
-         /* fscanf(fp, "%lf", (*A)[i]+j); */
-            fscanf(fp, "%lf", *(*A+i)+j);
+   /* Memory allocation. */
+   if (result == EXIT_SUCCESS) {
+      result = allocate_LP(*m, *n, A, b, c);
+   }
+
+   /* Copying the values into A, b and c. */
+   if (result == EXIT_SUCCESS) {
+      if ((result = parse_numbers(filename, &ps, *c, *n)) == EXIT_SUCCESS &&
+          (result = parse_numbers(filename, &ps, *b, *m)) == EXIT_SUCCESS &&
+          (result = parse_numbers(filename, &ps, (*A)[0], (size_t) *m * *n)) == EXIT_SUCCESS) {
+         skip_space(&ps);
+         if (ps.p != ps.end) {
+            result = parse_error(filename, &ps, "unexpected text after the LP");
          }
       }
+   }
 
-      fclose(fp);
-      return EXIT_SUCCESS;
+   if (mapped) {
+      munmap(text, size);
+   } else {
+      free(text);
+   }
+   if (result != EXIT_SUCCESS) {
+      release_memory(*A, *b, *c);
+      *A = NULL;
+      *b = NULL;
+      *c = NULL;
    }
+   return result;
 }
 
 void test_it(const char * lp_file)
@@ -128,6 +646,6 @@ void test_it(const char * lp_file)
          }
       }
 
-      release_memory(m, A, b, c);
+      release_memory(A, b, c);
    }
 }
\ No newline at end of file
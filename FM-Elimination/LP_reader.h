@@ -1,5 +1,48 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+/* Binary LP files start with this, see write_LP_binary */
+#define LP_BINARY_MAGIC "LPBIN\0v1"
+/* Blocks in binary LP files start at multiples of this many bytes */
+#define LP_BINARY_ALIGN 64
+
+/* Header of a binary LP file. It is followed by the blocks c, b
+ * and A, each aligned to LP_BINARY_ALIGN. A is stored either row
+ * by row, or (if sparse) as compressed sparse columns: col_start
+ * (n+1 entries), row_index and values (nnz entries each). All in
+ * the byte order of the machine that wrote the file. */
+typedef struct {
+	char magic[8];
+	int m;
+	int n;
+	int sparse;
+	unsigned int nnz;
+} LPBinaryHeader;
+
+/* A binary LP file mapped into memory. The data is not copied:
+ * all pointers point into the mapping, and either A (dense) or
+ * col_start, row_index and values (sparse) are set. */
+typedef struct {
+	int m;
+	int n;
+	int sparse;
+	unsigned int nnz;
+	const double *c;
+	const double *b;
+	const double *A;
+	const unsigned int *col_start;
+	const unsigned int *row_index;
+	const double *values;
+	void *map;
+	size_t size;
+} LPBinary;
+
 int read_LP(const char*, int*, int*, 
 			double***, double**, double**);
+void release_memory(double**, double*, double*);
+
+int is_LP_binary(const char*);
+int map_LP_binary(const char*, LPBinary*);
+void unmap_LP_binary(LPBinary*);
+int write_LP_binary(const char*, int, int,
+			double**, double*, double*);
@@ -0,0 +1,772 @@
+#include "MPS_reader.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <string.h>
+
+/* Sections of an MPS file. */
+#define MPS_NONE     0
+#define MPS_ROWS     1
+#define MPS_COLUMNS  2
+#define MPS_RHS      3
+#define MPS_RANGES   4
+#define MPS_BOUNDS   5
+#define MPS_OBJSENSE 6
+#define MPS_END      7
+
+/* Names of rows or columns and their indices, in a hash table
+   with open addressing. */
+typedef struct {
+   char ** names;
+   int *   index;
+   int     size;     /* Number of slots, a power of two */
+   int     count;
+} NameTable;
+
+/* Everything read from an MPS file so far. Rows of type 'N' other
+   than the objective are kept, but their entries are dropped. */
+typedef struct {
+   NameTable     rows;
+   char *        row_type;
+   double *      rhs;
+   double *      range;      /* NAN if the row has no range */
+   int           m;
+   int           objective;  /* Row of the objective, or -1 */
+
+   NameTable     cols;
+   double *      cost;
+   double *      lower;
+   double *      upper;
+   int           n;
+
+   /* Entries of A as triplets */
+   int *         entry_row;
+   int *         entry_col;
+   double *      entry_value;
+   size_t        entries;
+
+   int           maximize;
+   int           capacity_m;
+   int           capacity_n;
+   size_t        capacity_entries;
+} MPS;
+
+unsigned long hash_name(const char * name)
+{
+   unsigned long h = 14695981039346656037UL;
+
+   for (; *name; name++) {
+      h = (h ^ (unsigned char) *name) * 1099511628211UL;
+   }
+   return h;
+}
+
+/* Return the index of name, or -1 if it is not in the table. */
+int find_name(const NameTable * table, const char * name)
+{
+   unsigned long k;
+
+   if (!table->size) {
+      return -1;
+   }
+   for (k = hash_name(name) & (table->size - 1); table->names[k];
+        k = (k + 1) & (table->size - 1)) {
+      if (!strcmp(table->names[k], name)) {
+         return table->index[k];
+      }
+   }
+   return -1;
+}
+
+/* Add a name that is not in the table yet. */
+void add_name(NameTable * table, const char * name, int index)
+{
+   NameTable     old = *table;
+   unsigned long k;
+   int           i;
+
+   if (2 * (table->count + 1) > table->size) {
+      table->size = (old.size ? 2 * old.size : 1024);
+      table->names = calloc(table->size, sizeof(char*));
+      table->index = calloc(table->size, sizeof(int));
+      table->count = 0;
+      for (i = 0; i < old.size; i++) {
+         if (old.names[i]) {
+            for (k = hash_name(old.names[i]) & (table->size - 1); table->names[k];
+                 k = (k + 1) & (table->size - 1));
+            table->names[k] = old.names[i];
+            table->index[k] = old.index[i];
+            table->count++;
+         }
+      }
+      free(old.names);
+      free(old.index);
+   }
+   for (k = hash_name(name) & (table->size - 1); table->names[k];
+        k = (k + 1) & (table->size - 1));
+   table->names[k] = strdup(name);
+   table->index[k] = index;
+   table->count++;
+}
+
+void free_names(NameTable * table)
+{
+   int i;
+
+   for (i = 0; i < table->size; i++) {
+      free(table->names[i]);
+   }
+   free(table->names);
+   free(table->index);
+}
+
+int add_row(MPS * mps, char type, const char * name)
+{
+   if (mps->m == mps->capacity_m) {
+      mps->capacity_m = (mps->capacity_m ? 2 * mps->capacity_m : 1024);
+      mps->row_type = realloc(mps->row_type, mps->capacity_m * sizeof(char));
+      mps->rhs = realloc(mps->rhs, mps->capacity_m * sizeof(double));
+      mps->range = realloc(mps->range, mps->capacity_m * sizeof(double));
+   }
+   mps->row_type[mps->m] = type;
+   mps->rhs[mps->m] = 0;
+   mps->range[mps->m] = NAN;
+   add_name(&mps->rows, name, mps->m);
+   return mps->m++;
+}
+
+int add_col(MPS * mps, const char * name)
+{
+   if (mps->n == mps->capacity_n) {
+      mps->capacity_n = (mps->capacity_n ? 2 * mps->capacity_n : 1024);
+      mps->cost = realloc(mps->cost, mps->capacity_n * sizeof(double));
+      mps->lower = realloc(mps->lower, mps->capacity_n * sizeof(double));
+      mps->upper = realloc(mps->upper, mps->capacity_n * sizeof(double));
+   }
+   mps->cost[mps->n] = 0;
+   mps->lower[mps->n] = 0;
+   mps->upper[mps->n] = INFINITY;
+   add_name(&mps->cols, name, mps->n);
+   return mps->n++;
+}
+
+void add_entry(MPS * mps, int row, int col, double value)
+{
+   if (mps->entries == mps->capacity_entries) {
+      mps->capacity_entries = (mps->capacity_entries ? 2 * mps->capacity_entries : 1024);
+      mps->entry_row = realloc(mps->entry_row, mps->capacity_entries * sizeof(int));
+      mps->entry_col = realloc(mps->entry_col, mps->capacity_entries * sizeof(int));
+      mps->entry_value = realloc(mps->entry_value, mps->capacity_entries * sizeof(double));
+   }
+   mps->entry_row[mps->entries] = row;
+   mps->entry_col[mps->entries] = col;
+   mps->entry_value[mps->entries] = value;
+   mps->entries++;
+}
+
+void free_MPS(MPS * mps)
+{
+   free_names(&mps->rows);
+   free_names(&mps->cols);
+   free(mps->row_type);
+   free(mps->rhs);
+   free(mps->range);
+   free(mps->cost);
+   free(mps->lower);
+   free(mps->upper);
+   free(mps->entry_row);
+   free(mps->entry_col);
+   free(mps->entry_value);
+}
+
+/* Split a line into at most 6 fields. In free format, fields are
+   separated by white space. In fixed format, the fields of data
+   lines are in columns 2-3, 5-12, 15-22, 25-36, 40-47 and 50-61,
+   and names may contain spaces. Empty fields are left out. Returns
+   the number of fields, or -1 if there is text outside of them. */
+int split_fields(char * line, int fixed, char * field[6])
+{
+   const int start[6] = {1, 4, 14, 24, 39, 49};
+   const int end[6]   = {3, 12, 22, 36, 47, 61};
+   int       length = strlen(line);
+   int       count = 0;
+   int       i;
+   int       j;
+
+   /* Section headers are split as in free format. */
+   if (fixed && !isspace((unsigned char) line[0])) {
+      fixed = 0;
+   }
+
+   if (fixed) {
+      for (i = 0; i < length; i++) {
+         if (!isspace((unsigned char) line[i])) {
+            for (j = 0; j < 6 && (i < start[j] || i >= end[j]); j++);
+            if (j == 6) {
+               return -1;
+            }
+         }
+      }
+      for (j = 0; j < 6 && start[j] < length; j++) {
+         /* Trim the field and cut it off. */
+         for (i = start[j]; i < end[j] && i < length && isspace((unsigned char) line[i]); i++);
+         if (i == end[j] || i >= length) {
+            continue;
+         }
+         field[count++] = line + i;
+         for (i = (end[j] < length ? end[j] : length);
+              isspace((unsigned char) line[i - 1]); i--);
+         line[i] = '\0';
+      }
+      return count;
+   }
+
+   for (i = 0; i < length; ) {
+      for (; i < length && isspace((unsigned char) line[i]); i++);
+      if (i == length) {
+         break;
+      }
+      if (count == 6) {
+         return -1;
+      }
+      field[count++] = line + i;
+      for (; i < length && !isspace((unsigned char) line[i]); i++);
+      line[i++] = '\0';
+   }
+   return count;
+}
+
+/* Parse a number, which has to make up all of text. */
+int parse_value(const char * text, double * value)
+{
+   char * stop;
+
+   *value = strtod(text, &stop);
+   return (stop != text && *stop == '\0');
+}
+
+int is_MPS(const char * filename)
+{
+   FILE *  fp;
+   char *  line = NULL;
+   size_t  capacity = 0;
+   int     result = 0;
+   char *  p;
+
+   if (!(fp = fopen(filename, "r"))) {
+      return 0;
+   }
+   while (getline(&line, &capacity, fp) > 0) {
+      for (p = line; isspace((unsigned char) *p); p++);
+      if (*p == '\0' || *line == '*') {
+         continue;
+      }
+      result = (!strncmp(line, "NAME", 4) || !strncmp(line, "ROWS", 4) ||
+                !strncmp(line, "OBJSENSE", 8));
+      break;
+   }
+   free(line);
+   fclose(fp);
+   return result;
+}
+
+/* Helper for read_MPS: read one data line of the given section. */
+const char *read_MPS_line(MPS * mps, int section, char ** field, int count)
+{
+   double value;
+   int    row;
+   int    col;
+   int    i;
+   int    first;
+
+   switch (section) {
+   case MPS_ROWS:
+      if (count != 2 || strlen(field[0]) != 1 || !strchr("NLGE", field[0][0])) {
+         return "expected a row type (N, L, G or E) and a name";
+      }
+      if (find_name(&mps->rows, field[1]) != -1) {
+         return "row defined twice";
+      }
+      row = add_row(mps, field[0][0], field[1]);
+      if (field[0][0] == 'N' && mps->objective == -1) {
+         mps->objective = row;
+      }
+      return NULL;
+
+   case MPS_COLUMNS:
+      if (count >= 3 && !strcmp(field[1], "'MARKER'")) {
+         return NULL;
+      }
+      if (count != 3 && count != 5) {
+         return "expected a column name and one or two rows with values";
+      }
+      if ((col = find_name(&mps->cols, field[0])) == -1) {
+         col = add_col(mps, field[0]);
+      }
+      for (i = 1; i < count; i += 2) {
+         if ((row = find_name(&mps->rows, field[i])) == -1) {
+            return "unknown row";
+         }
+         if (!parse_value(field[i + 1], &value)) {
+            return "expected a number";
+         }
+         if (row == mps->objective) {
+            mps->cost[col] += value;
+         } else if (mps->row_type[row] != 'N' && value != 0) {
+            add_entry(mps, row, col, value);
+         }
+      }
+      return NULL;
+
+   case MPS_RHS:
+   case MPS_RANGES:
+      /* The name of the set of right-hand sides is optional. */
+      first = count % 2;
+      if (count - first != 2 && count - first != 4) {
+         return "expected one or two rows with values";
+      }
+      for (i = first; i < count; i += 2) {
+         if ((row = find_name(&mps->rows, field[i])) == -1) {
+            return "unknown row";
+         }
+         if (!parse_value(field[i + 1], &value)) {
+            return "expected a number";
+         }
+         /* The right-hand side of the objective is a constant
+            in it, which does not matter for the solution. */
+         if (mps->row_type[row] == 'N') {
+            continue;
+         }
+         if (section == MPS_RHS) {
+            mps->rhs[row] = value;
+         } else {
+            mps->range[row] = value;
+         }
+      }
+      return NULL;
+
+   case MPS_BOUNDS:
+      if (count < 2) {
+         return "expected a bound type and a column";
+      }
+      /* The name of the set of bounds is optional, and so is the
+         value for types that do not need one. */
+      if (!strcmp(field[0], "FR") || !strcmp(field[0], "MI") ||
+          !strcmp(field[0], "PL") || !strcmp(field[0], "BV")) {
+         col = (count >= 3 ? 2 : 1);
+         value = 0;
+      } else {
+         if (count != 3 && count != 4) {
+            return "expected a bound type, a column and a value";
+         }
+         col = count - 2;
+         if (!parse_value(field[count - 1], &value)) {
+            return "expected a number";
+         }
+      }
+      if ((col = find_name(&mps->cols, field[col])) == -1) {
+         return "unknown column";
+      }
+      if (!strcmp(field[0], "UP") || !strcmp(field[0], "UI")) {
+         mps->upper[col] = value;
+      } else if (!strcmp(field[0], "LO") || !strcmp(field[0], "LI")) {
+         mps->lower[col] = value;
+      } else if (!strcmp(field[0], "FX")) {
+         mps->lower[col] = mps->upper[col] = value;
+      } else if (!strcmp(field[0], "FR")) {
+         mps->lower[col] = -INFINITY;
+         mps->upper[col] = INFINITY;
+      } else if (!strcmp(field[0], "MI")) {
+         mps->lower[col] = -INFINITY;
+      } else if (!strcmp(field[0], "PL")) {
+         mps->upper[col] = INFINITY;
+      } else if (!strcmp(field[0], "BV")) {
+         mps->lower[col] = 0;
+         mps->upper[col] = 1;
+      } else {
+         return "unknown bound type";
+      }
+      return NULL;
+
+   case MPS_OBJSENSE:
+      if (count != 1) {
+         return "expected MAX or MIN";
+      }
+      if (!strcmp(field[0], "MAX") || !strcmp(field[0], "MAXIMIZE")) {
+         mps->maximize = 1;
+      } else if (!strcmp(field[0], "MIN") || !strcmp(field[0], "MINIMIZE")) {
+         mps->maximize = 0;
+      } else {
+         return "expected MAX or MIN";
+      }
+      return NULL;
+   }
+   return "data outside of a section";
+}
+
+/* Helper for read_MPS: turn what was read into lp, with a row in
+   Ax <= b for every finite bound on a row or column. The arrays of
+   lp are left to the caller to free on error. */
+const char *build_sparse_LP(MPS * mps, int free_vars, SparseLP * lp)
+{
+   const char *   error = NULL;
+   int *          upper_row = NULL;
+   int *          lower_row = NULL;
+   double *       upper = NULL;
+   double *       lower = NULL;
+   unsigned int * row_start = NULL;
+   unsigned int * order = NULL;
+   unsigned int * entry_row = NULL;
+   unsigned int * entry_col = NULL;
+   double *       entry_value = NULL;
+   double         range;
+   size_t         entries;
+   size_t         k;
+   size_t         l;
+   int            i;
+   int            j;
+
+   upper_row = malloc((mps->m + 1) * sizeof(int));
+   lower_row = malloc((mps->m + 1) * sizeof(int));
+   upper = malloc((mps->m + 1) * sizeof(double));
+   lower = malloc((mps->m + 1) * sizeof(double));
+   if (!upper_row || !lower_row || !upper || !lower) {
+      error = "memory allocation failure";
+      goto cleanup;
+   }
+
+   /* Rows of Ax <= b for the rows of the MPS file, */
+   lp->m = 0;
+   for (i = 0; i < mps->m; i++) {
+      lower[i] = -INFINITY;
+      upper[i] = INFINITY;
+      range = mps->range[i];
+      switch (mps->row_type[i]) {
+      case 'L':
+         upper[i] = mps->rhs[i];
+         if (!isnan(range)) {
+            lower[i] = upper[i] - fabs(range);
+         }
+         break;
+      case 'G':
+         lower[i] = mps->rhs[i];
+         if (!isnan(range)) {
+            upper[i] = lower[i] + fabs(range);
+         }
+         break;
+      case 'E':
+         lower[i] = upper[i] = mps->rhs[i];
+         if (range > 0) {
+            upper[i] += range;
+         } else if (range < 0) {
+            lower[i] += range;
+         }
+         break;
+      }
+      upper_row[i] = (upper[i] < INFINITY ? lp->m++ : -1);
+      lower_row[i] = (lower[i] > -INFINITY ? lp->m++ : -1);
+   }
+
+   /* and for the bounds on the columns. */
+   entries = 0;
+   for (k = 0; k < mps->entries; k++) {
+      entries += (upper_row[mps->entry_row[k]] != -1) + (lower_row[mps->entry_row[k]] != -1);
+   }
+   for (j = 0; j < mps->n; j++) {
+      if (!free_vars && mps->lower[j] < 0) {
+         error = "negative lower bounds are not supported, as variables are non-negative";
+         goto cleanup;
+      }
+      entries += (mps->upper[j] < INFINITY);
+      entries += (free_vars ? mps->lower[j] > -INFINITY : mps->lower[j] > 0);
+   }
+   if (entries > 0xffffffffUL) {
+      error = "too many non-zero entries";
+      goto cleanup;
+   }
+
+   entry_row = malloc((entries + 1) * sizeof(unsigned int));
+   entry_col = malloc((entries + 1) * sizeof(unsigned int));
+   entry_value = malloc((entries + 1) * sizeof(double));
+   lp->b = malloc((lp->m + mps->n + 1) * sizeof(double));
+   if (!entry_row || !entry_col || !entry_value || !lp->b) {
+      error = "memory allocation failure";
+      goto cleanup;
+   }
+   l = 0;
+   for (k = 0; k < mps->entries; k++) {
+      i = mps->entry_row[k];
+      if (upper_row[i] != -1) {
+         entry_row[l] = upper_row[i];
+         entry_col[l] = mps->entry_col[k];
+         entry_value[l++] = mps->entry_value[k];
+      }
+      if (lower_row[i] != -1) {
+         entry_row[l] = lower_row[i];
+         entry_col[l] = mps->entry_col[k];
+         entry_value[l++] = -mps->entry_value[k];
+      }
+   }
+   for (i = 0; i < mps->m; i++) {
+      if (upper_row[i] != -1) {
+         lp->b[upper_row[i]] = upper[i];
+      }
+      if (lower_row[i] != -1) {
+         lp->b[lower_row[i]] = -lower[i];
+      }
+   }
+   for (j = 0; j < mps->n; j++) {
+      if (mps->upper[j] < INFINITY) {
+         entry_row[l] = lp->m;
+         entry_col[l] = j;
+         entry_value[l++] = 1;
+         lp->b[lp->m++] = mps->upper[j];
+      }
+      if (free_vars ? mps->lower[j] > -INFINITY : mps->lower[j] > 0) {
+         entry_row[l] = lp->m;
+         entry_col[l] = j;
+         entry_value[l++] = -1;
+         lp->b[lp->m++] = -mps->lower[j];
+      }
+   }
+
+   /* Sort the entries by row, and then (stably) by column,
+      so that the rows in each column are sorted. */
+   row_start = calloc(lp->m + 1, sizeof(unsigned int));
+   order = malloc((entries + 1) * sizeof(unsigned int));
+   if (!row_start || !order) {
+      error = "memory allocation failure";
+      goto cleanup;
+   }
+   for (k = 0; k < entries; k++) {
+      row_start[entry_row[k] + 1]++;
+   }
+   for (i = 0; i < lp->m; i++) {
+      row_start[i + 1] += row_start[i];
+   }
+   for (k = 0; k < entries; k++) {
+      order[row_start[entry_row[k]]++] = k;
+   }
+
+   lp->n = mps->n;
+   lp->col_start = calloc(lp->n + 1, sizeof(unsigned int));
+   lp->row_index = malloc((entries + 1) * sizeof(unsigned int));
+   lp->values = malloc((entries + 1) * sizeof(double));
+   lp->c = malloc((lp->n + 1) * sizeof(double));
+   if (!lp->col_start || !lp->row_index || !lp->values || !lp->c) {
+      error = "memory allocation failure";
+      goto cleanup;
+   }
+   for (k = 0; k < entries; k++) {
+      lp->col_start[entry_col[k] + 1]++;
+   }
+   for (j = 0; j < lp->n; j++) {
+      lp->col_start[j + 1] += lp->col_start[j];
+   }
+   for (k = 0; k < entries; k++) {
+      l = lp->col_start[entry_col[order[k]]]++;
+      lp->row_index[l] = entry_row[order[k]];
+      lp->values[l] = entry_value[order[k]];
+   }
+   for (j = lp->n; j > 0; j--) {
+      lp->col_start[j] = lp->col_start[j - 1];
+   }
+   lp->col_start[0] = 0;
+
+   /* Add up entries given twice for the same row and column. */
+   l = 0;
+   for (j = 0; j < lp->n; j++) {
+      k = lp->col_start[j];
+      lp->col_start[j] = l;
+      for (; k < lp->col_start[j + 1]; k++) {
+         if (l > lp->col_start[j] && lp->row_index[l - 1] == lp->row_index[k]) {
+            lp->values[l - 1] += lp->values[k];
+         } else {
+            lp->row_index[l] = lp->row_index[k];
+            lp->values[l++] = lp->values[k];
+         }
+      }
+   }
+   lp->col_start[lp->n] = l;
+   lp->nnz = l;
+
+   for (j = 0; j < lp->n; j++) {
+      lp->c[j] = (mps->maximize ? mps->cost[j] : -mps->cost[j]);
+   }
+
+cleanup:
+   free(upper_row);
+   free(lower_row);
+   free(upper);
+   free(lower);
+   free(row_start);
+   free(order);
+   free(entry_row);
+   free(entry_col);
+   free(entry_value);
+   return error;
+}
+
+/* Helper for read_MPS: read the sections of an MPS file into
+   mps, in fixed or free format. Returns an error message, or
+   NULL, and the number of the line the error is on. */
+const char *parse_MPS(FILE * fp, int fixed, MPS * mps, int * line_number)
+{
+   char *       line = NULL;
+   char *       field[6];
+   const char * error = NULL;
+   size_t       capacity = 0;
+   ssize_t      length;
+   int          section = MPS_NONE;
+   int          count;
+
+   memset(mps, 0, sizeof(MPS));
+   mps->objective = -1;
+   *line_number = 0;
+   while (!error && section != MPS_END && (length = getline(&line, &capacity, fp)) > 0) {
+      (*line_number)++;
+      while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+         line[--length] = '\0';
+      }
+      if (line[0] == '*') {
+         continue;
+      }
+      if ((count = split_fields(line, fixed, field)) == 0) {
+         continue;
+      }
+      if (count == -1) {
+         error = "text outside of the fields";
+      } else if (!isspace((unsigned char) line[0])) {
+         /* Section header */
+         if (!strcmp(field[0], "NAME")) {
+            section = MPS_NONE;
+         } else if (!strcmp(field[0], "ROWS")) {
+            section = MPS_ROWS;
+         } else if (!strcmp(field[0], "COLUMNS")) {
+            section = MPS_COLUMNS;
+         } else if (!strcmp(field[0], "RHS")) {
+            section = MPS_RHS;
+         } else if (!strcmp(field[0], "RANGES")) {
+            section = MPS_RANGES;
+         } else if (!strcmp(field[0], "BOUNDS")) {
+            section = MPS_BOUNDS;
+         } else if (!strcmp(field[0], "OBJSENSE")) {
+            section = MPS_OBJSENSE;
+            /* In free format, the sense may follow on the same line. */
+            if (count == 2) {
+               error = read_MPS_line(mps, section, field + 1, 1);
+            }
+         } else if (!strcmp(field[0], "ENDATA")) {
+            section = MPS_END;
+         } else {
+            error = "unsupported section";
+         }
+      } else {
+         error = read_MPS_line(mps, section, field, count);
+      }
+   }
+   free(line);
+
+   if (!error && section != MPS_END) {
+      error = "missing ENDATA";
+   }
+   return error;
+}
+
+/* Read an LP from an MPS file into lp. The file is read in free
+   format, and if that fails in fixed format (see split_fields).
+   The objective is the first row of type N; it is minimized unless
+   an OBJSENSE section says otherwise, and lp maximizes its negation
+   in that case. Every finite bound on a row or column becomes a row
+   of Ax <= b, so equality and ranged rows give two rows. Lower
+   bounds of zero are implicit, as in the simplex, unless free_vars
+   is set: then variables are taken to be free, as in FM, and all
+   lower bounds become rows. A is built in compressed sparse columns
+   from the start. Malformed input is reported with its line number.
+*/
+int read_MPS(const char * filename, int free_vars, SparseLP * lp)
+{
+   FILE *       fp;
+   MPS          mps;
+   const char * error;
+   int          line_number;
+   int          fixed_line_number;
+
+   memset(lp, 0, sizeof(SparseLP));
+   if (!(fp = fopen(filename, "r"))) {
+      fprintf(stderr, "Could not open \"%s\".\n", filename);
+      return EXIT_FAILURE;
+   }
+   if ((error = parse_MPS(fp, 0, &mps, &line_number))) {
+      free_MPS(&mps);
+      rewind(fp);
+      if (!parse_MPS(fp, 1, &mps, &fixed_line_number)) {
+         error = NULL;
+      }
+   }
+   fclose(fp);
+
+   if (!error) {
+      error = build_sparse_LP(&mps, free_vars, lp);
+      line_number = 0;
+   }
+   free_MPS(&mps);
+   if (error) {
+      if (line_number) {
+         fprintf(stderr, "%s:%d: %s.\n", filename, line_number, error);
+      } else {
+         fprintf(stderr, "%s: %s.\n", filename, error);
+      }
+      free_sparse_LP(lp);
+      return EXIT_FAILURE;
+   }
+   return EXIT_SUCCESS;
+}
+
+/* Copy lp to A, b and c in the layout of read_LP. */
+int sparse_LP_to_dense(const SparseLP * lp,
+                       int *            m,
+                       int *            n,
+                       double ***       A,
+                       double **        b,
+                       double **        c)
+{
+   unsigned int k;
+   int          i;
+   int          j;
+
+   *m = lp->m;
+   *n = lp->n;
+   *b = malloc((*m + 1) * sizeof(double));
+   *c = malloc((*n + 1) * sizeof(double));
+   *A = calloc(*m ? *m : 1, sizeof(double*));
+   if (!*b || !*c || !*A ||
+       !((*A)[0] = calloc((size_t) *m * *n + 1, sizeof(double)))) {
+      fprintf(stderr, "Memory allocation failure.\n");
+      free(*A);
+      free(*b);
+      free(*c);
+      return EXIT_FAILURE;
+   }
+   for (i = 1; i < *m; i++) {
+      (*A)[i] = (*A)[0] + (size_t) i * *n;
+   }
+   memcpy(*b, lp->b, *m * sizeof(double));
+   memcpy(*c, lp->c, *n * sizeof(double));
+   for (j = 0; j < *n; j++) {
+      for (k = lp->col_start[j]; k < lp->col_start[j + 1]; k++) {
+         (*A)[lp->row_index[k]][j] = lp->values[k];
+      }
+   }
+   return EXIT_SUCCESS;
+}
+
+void free_sparse_LP(SparseLP * lp)
+{
+   free(lp->col_start);
+   free(lp->row_index);
+   free(lp->values);
+   free(lp->b);
+   free(lp->c);
+   memset(lp, 0, sizeof(SparseLP));
+}
@@ -0,0 +1,24 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/* An LP read from an MPS file, in the form read_LP gives:
+ * maximize cx subject to Ax <= b. A is stored as compressed
+ * sparse columns: the entries of column j are values[k] in
+ * rows row_index[k], for col_start[j] <= k < col_start[j+1],
+ * sorted by row. */
+typedef struct {
+	int m;
+	int n;
+	unsigned int nnz;
+	unsigned int *col_start;
+	unsigned int *row_index;
+	double *values;
+	double *b;
+	double *c;
+} SparseLP;
+
+int is_MPS(const char*);
+int read_MPS(const char*, int, SparseLP*);
+int sparse_LP_to_dense(const SparseLP*, int*, int*,
+			double***, double**, double**);
+void free_sparse_LP(SparseLP*);
@@ -15,18 +15,43 @@
  *  the problem: otherwise GIGO applies.
  */
 
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
 #include "fm.h"
 
+Options options = {0, 1, 0, 0, NULL, 0};
+
 /* Free memory allocated to an LP,
  * assuming c is not used. */
 void free_LP(LP* P) {
 	int i, j, k;
+	if ((*P).ps)
+		free_presolve((*P).ps);
+	if ((*P).map) {
+		munmap((*P).map, (*P).map_size);
+		free((*P).A);
+		free(P);
+		return;
+	}
 	for (i = 0; i< (*P).m; i++) {
-		free((*P).A[i]);
-		free((*P).C[i]);
+		if (!(*P).block)
+			free((*P).A[i]);
+		if ((*P).H)
+			free((*P).H[i]);
 	}
 	free((*P).A);	
-	free((*P).C);
+	free((*P).block);
+	free((*P).H);
+	free((*P).p);
+	free((*P).q);
+	free((*P).scale);
+	free((*P).var);
 	free((*P).b);
 	free(P);
 }
@@ -41,15 +66,65 @@ void free_sequence(LP **R) {
 }
 
 /* Print the word 'empty' followed by a certificate
- * showing the fully reduced LP P is infeasible, 
- * given an i such that b[i] < 0, using the i-th
- * row of C. */
-void print_certificate(LP* P, int c) {
-	int i;
-	printf("empty ");
-    printf("[");
-	for (i = 0; i < (*P).orig_m; i++)
-        printf("%.3lf%s", (*P).C[c][i], (i == ((*P).orig_m-1) ? "]\n" : ", "));
+ * showing the fully reduced LP R[k] is infeasible, 
+ * given a c such that b[c] < 0. The certificate is
+ * found by following the combinations row c is made
+ * of back through the sequence R of LPs. */
+void print_certificate(LP** R, int k, int c) {
+	int i, l, m;
+	double *w, *prev_w, max;
+
+	/* w[i] is the weight of row i of R[l] */
+	w = calloc((*R[k]).m, sizeof(double));
+	w[c] = 1;
+	for (l = k; l >= 0; l--) {
+		prev_w = calloc(l ? (*R[l-1]).m : (*R[l]).orig_m, sizeof(double));
+		for (i = 0; i < (*R[l]).m; i++) {
+			if (w[i] == 0)
+				continue;
+			prev_w[(*R[l]).p[i]] += w[i] * (*R[l]).scale[i];
+			if ((*R[l]).q[i] != -1)
+				prev_w[(*R[l]).q[i]] += w[i] * (*R[l]).scale[i];
+		}
+		free(w);
+		w = prev_w;
+	}
+
+	/* Map w back to the rows of the LP before presolving */
+	m = (*R[0]).orig_m;
+	if ((*R[0]).ps) {
+		prev_w = postsolve_certificate((*R[0]).ps, w);
+		free(w);
+		w = prev_w;
+		m = (*(*R[0]).ps).m;
+	}
+
+	/* Any positive multiple of a certificate is one as well.
+	 * Scale the largest weight to 1, so that the decimals
+	 * printed are relative to the weights. */
+	max = 0;
+	for (i = 0; i < m; i++) {
+		if (w[i] > max)
+			max = w[i];
+	}
+	if (max > 0) {
+		for (i = 0; i < m; i++)
+			w[i] /= max;
+	}
+	print_weights(w, m);
+}
+
+/* Print the weights of a certificate provided by print_certificate.
+ * As the rows are added up with them, so are their rounding
+ * errors: they get more decimals than a solution. */
+void print_weights(double *w, int m) {
+    int i;
+    printf("empty [");
+    for (i = 0; i < m; i++) {
+        printf("%.9lf%s", w[i], (i == m - 1? "]\n" : ", "));
+    }
+    /* Free w. */
+    free(w);
 }
 
 /* Print a solution vector provided by find_solution. */
@@ -63,48 +138,47 @@ void print_solution(double *sol, int n) {
     free(sol);
 }
 
-/* Find a solution given a sequence of LPs by back-substitution. */
+/* Find a solution given a sequence of LPs by back-substitution.
+ * Only the rows with a non-zero coefficient for the variable
+ * being fixed are used, see release_rows. The variable in
+ * column j of R[i] is x_{var[j]}, see order_LP. */
 double *find_solution(LP **R) {
-	int i, j, k, l, n, m, max_set, min_set;
-	double min, max;
-	double *b;
-	LP *P = R[0];
-	n = (*P).n;
+	int i, j, k, n, max_set, min_set;
+	double min, max, r;
+	LP *P;
+	n = (*R[0]).n;
 	double *sol = calloc(n, sizeof(double));
 
 	/* Starting at the second to last LP, backtrack
 	 * through the entire sequence R of LPs. */
-	for (i = 1; i <= n; i++){
+	for (i = n - 1; i >= 0; i--){
+		P = R[i];
 		min = 0;
 		max = 0;
 		min_set = 0;
 		max_set = 0;
 
-		/* Update b in the n-i-th LP by back-substitution. */
-		b = calloc((*R[n-i]).m, sizeof(double));
-		for (k = 0; k < (*R[n-i]).m; k++)
-			b[k] += (*R[n-i]).b[k];
-
-		/* Update the values using previously found solutions 
-		 * for the variables x_{n-i+1}, ..., x_n. */
-		for (j = 1; j < i; j++) {
-			for (k = 0; k < (*R[n-i]).m; k++)
-				b[k] -= (*R[n-i]).A[k][j] * sol[n - (i-j)];
-		}
-
-		/* Find a value for x_{n-i} using the updated b. */
-		for (l = 0; l < (*R[n-i]).m; l++) {
-			/* Update min if i-th to last variable negative. */
-			if ((*R[n-i]).A[l][0] < 0) {
-				if (-b[l] > min || min_set == 0) {
-					min = -b[l];
+		for (k = 0; k < (*P).m; k++) {
+			if (!(*P).A[k] || (*P).A[k][0] == 0)
+				continue;
+
+			/* Residual of row k using the previously found
+			 * solutions for the other variables of P. */
+			r = (*P).b[k];
+			for (j = 1; j < n - i; j++)
+				r -= (*P).A[k][j] * sol[(*P).var[j]];
+
+			/* Update min if the variable is negative, max if
+			 * it is positive (the rows are normalized). */
+			if ((*P).A[k][0] < 0) {
+				if (-r > min || min_set == 0) {
+					min = -r;
 					min_set = 1;
 				}
 			}
-			/* Update max if i-th to last variable positive. */
-			if ((*R[n-i]).A[l][0] > 0) {
-				if (b[l] < max || max_set == 0) {
-					max = b[l];
+			else {
+				if (r < max || max_set == 0) {
+					max = r;
 					max_set = 1;
 				}
 			}
@@ -114,72 +188,527 @@ double *find_solution(LP **R) {
 			max = min+1;
 		if (!min_set)
 			min = max-1;
-		sol[n-i] = (max + min) / 2.0;
-		free(b);
+		sol[(*P).var[0]] = (max + min) / 2.0;
+
+		/* P is not needed anymore, if spilled let it go. */
+		if ((*P).map)
+			madvise((*P).map, (*P).map_size, MADV_DONTNEED);
 	}
 	return sol;
 }
 
+/* Free the parts of an LP that are no longer needed once
+ * the next LP has been found: the rows with a zero first
+ * coefficient (which were copied to the next LP, and are
+ * kept if the rows were read as one block) and the
+ * histories. Only the combinations are kept for these. */
+void release_rows(LP *P) {
+	int i;
+	for (i = 0; i < (*P).m; i++) {
+		if (!(*P).block && (*P).A[i] && (*P).A[i][0] == 0) {
+			free((*P).A[i]);
+			(*P).A[i] = NULL;
+		}
+		if ((*P).H)
+			free((*P).H[i]);
+	}
+	free((*P).H);
+	(*P).H = NULL;
+}
+
+/* Decide for the source rows (*task).first, ..., (*task).last-1
+ * which pairs to combine, using Chernikov's rule: a combination
+ * of more than level+1 original rows, after eliminating level
+ * variables, is implied by the others. */
+void *count_pairs(void *arg) {
+	RowTask *task = arg;
+	LP *P = (*task).P;
+	int i, j, k, l, p, count, words;
+	char *keep;
+
+	words = HISTORY_WORDS((*P).orig_m);
+	for (k = (*task).first; k < (*task).last; k++) {
+		i = (*task).src[k];
+		if ((*P).A[i][0] <= 0) {
+			(*task).offset[k+1] = 1;
+			continue;
+		}
+		keep = (*task).keep + (long) (*task).pos[k] * (*P).n_neg;
+		(*task).offset[k+1] = 0;
+		for (p = 0; p < (*P).n_neg; p++) {
+			j = (*task).neg[p];
+			count = 0;
+			for (l = 0; l < words; l++)
+				count += __builtin_popcountl((*P).H[i][l] | (*P).H[j][l]);
+			keep[p] = (count <= (*P).level + 2);
+			(*task).offset[k+1] += keep[p];
+			(*task).rejected += !keep[p];
+		}
+	}
+	return NULL;
+}
+
+/* Build the rows (*task).first, ..., (*task).last-1 of an
+ * eliminated LP. Every row is written to its own slot,
+ * so any number of these can run at the same time. */
+void *build_rows(void *arg) {
+	RowTask *task = arg;
+	LP *P = (*task).P;
+	LP *new_P = (*task).new_P;
+	int i, j, k, l, p, s, words;
+	char *keep = NULL;
+
+	words = HISTORY_WORDS((*P).orig_m);
+
+	/* Find the source row of the first slot. */
+	k = 0;
+	l = (*P).n_pos + (*P).n_zero;
+	while (l - k > 1) {
+		if ((*task).offset[(k + l) / 2] <= (*task).first)
+			k = (k + l) / 2;
+		else
+			l = (k + l) / 2;
+	}
+
+	p = -1;
+	for (s = (*task).first; s < (*task).last; s++) {
+		/* Moving on to a new source row. */
+		if ((*task).offset[k+1] <= s || p == -1) {
+			while ((*task).offset[k+1] <= s)
+				k++;
+			keep = NULL;
+			if ((*task).keep && (*P).A[(*task).src[k]][0] > 0)
+				keep = (*task).keep + (long) (*task).pos[k] * (*P).n_neg;
+			/* Skip to the pair belonging to slot s. */
+			p = -1;
+			for (l = (*task).offset[k]; l <= s; l++) {
+				p++;
+				while (keep && !keep[p])
+					p++;
+			}
+		}
+		else {
+			p++;
+			while (keep && !keep[p])
+				p++;
+		}
+		i = (*task).src[k];
+		(*new_P).A[s] = calloc((*new_P).n, sizeof(double));
+		(*new_P).p[s] = i;
+		(*new_P).scale[s] = 1;
+
+		/* Positive/negative pair, add equations. */
+		if ((*P).A[i][0] > 0) {
+			j = (*task).neg[p];
+			for (l = 0; l < (*new_P).n; l++) {
+				(*new_P).A[s][l] = (*P).A[i][l+1] + (*P).A[j][l+1];
+				/* What is left of a coefficient that cancels
+				 * is rounding error, and must not be used to
+				 * normalize the row with later. */
+				if (fabs((*new_P).A[s][l]) <= CANCEL_TOL *
+						(fabs((*P).A[i][l+1]) + fabs((*P).A[j][l+1])))
+					(*new_P).A[s][l] = 0;
+			}
+			(*new_P).b[s] = (*P).b[i] + (*P).b[j];
+			(*new_P).q[s] = j;
+		}
+		/* Zero coefficient, just copy equation. */
+		else {
+			for (l = 0; l < (*new_P).n; l++)
+				(*new_P).A[s][l] = (*P).A[i][l+1];
+			(*new_P).b[s] = (*P).b[i];
+			(*new_P).q[s] = -1;
+			j = i;
+		}
+
+		if ((*new_P).H) {
+			(*new_P).H[s] = malloc(words * sizeof(unsigned long));
+			for (l = 0; l < words; l++)
+				(*new_P).H[s][l] = (*P).H[i][l] | (*P).H[j][l];
+		}
+	}
+	return NULL;
+}
+
+/* Run f on all tasks, each on its own thread. */
+void run_tasks(void *(*f)(void*), RowTask *tasks, int threads) {
+	int t;
+	if (threads == 1) {
+		f(&tasks[0]);
+		return;
+	}
+	pthread_t *workers = calloc(threads, sizeof(pthread_t));
+	for (t = 0; t < threads; t++) {
+		if (pthread_create(&workers[t], NULL, f, &tasks[t])) {
+			fprintf(stderr, "Could not create thread: exiting...\n");
+			exit(1);
+		}
+	}
+	for (t = 0; t < threads; t++)
+		pthread_join(workers[t], NULL);
+	free(workers);
+}
+
 /* Create a new LP, equivalent to the one given,
- * that has one fewer variables using FM-elimination */
+ * that has one fewer variables using FM-elimination.
+ * The rows are built by options.threads threads. */
 LP *eliminate_variable(LP *P) {
-	int i, j, k, count;
-	count = 0;
+	int i, t, n_src, n_pos, n_neg, threads, rejected, pruned;
+
+	/* Find the source rows and negative rows, keeping the
+	 * order in which the rows were always combined: row i
+	 * with all negative rows, or a copy of row i. */
+	int *src = calloc((*P).n_pos + (*P).n_zero, sizeof(int));
+	int *offset = calloc((*P).n_pos + (*P).n_zero + 1, sizeof(int));
+	int *pos = calloc((*P).n_pos + (*P).n_zero, sizeof(int));
+	int *neg = calloc((*P).n_neg, sizeof(int));
+	n_src = 0;
+	n_pos = 0;
+	n_neg = 0;
+	for (i = 0; i < (*P).m; i++) {
+		if ((*P).A[i][0] < 0)
+			neg[n_neg++] = i;
+		else {
+			src[n_src] = i;
+			pos[n_src] = ((*P).A[i][0] > 0 ? n_pos++ : -1);
+			offset[n_src + 1] = ((*P).A[i][0] > 0 ? (*P).n_neg : 1);
+			n_src++;
+		}
+	}
+
+	threads = (options.threads < 1 ? 1 : options.threads);
+	RowTask *tasks = calloc(threads, sizeof(RowTask));
+	for (t = 0; t < threads; t++) {
+		tasks[t].P = P;
+		tasks[t].src = src;
+		tasks[t].offset = offset;
+		tasks[t].neg = neg;
+		tasks[t].pos = pos;
+	}
+
+	/* When pruning, decide which pairs to combine first. There
+	 * is one for every positive and negative row, which may be
+	 * too many even if most of them will be rejected. */
+	rejected = 0;
+	if (options.prune) {
+		if ((long) n_pos * n_neg > MAX_ROWS) {
+			printf("Too many inequalities: exiting...\n");
+			exit(0);
+		}
+		char *keep = calloc((long) n_pos * n_neg + 1, sizeof(char));
+		for (t = 0; t < threads; t++) {
+			tasks[t].keep = keep;
+			tasks[t].first = (long) n_src * t / threads;
+			tasks[t].last = (long) n_src * (t + 1) / threads;
+		}
+		run_tasks(count_pairs, tasks, threads);
+		for (t = 0; t < threads; t++)
+			rejected += tasks[t].rejected;
+	}
+
+	/* Find the first slot of every source row. */
+	for (i = 0; i < n_src; i++)
+		offset[i + 1] += offset[i];
 
 	/* Allocate memory */
 	LP *new_P = calloc(1, sizeof(LP));
 	(*new_P).n = (*P).n - 1;
-	(*new_P).m = (*P).n_pos * (*P).n_neg + (*P).n_zero;
-	if((*new_P).m < 0 || (*new_P).m > 1000000) {
+	(*new_P).m = offset[n_src];
+	(*new_P).level = (*P).level + 1;
+	if((*new_P).m < 0 || (*new_P).m > MAX_ROWS) {
 		printf("Too many inequalities: exiting...\n");
 		exit(0);
 	}
 	(*new_P).orig_m = (*P).orig_m;
 	(*new_P).A = calloc((*new_P).m, sizeof(double*));
-	(*new_P).C = calloc((*new_P).m, sizeof(double*));
-	
-	for (i = 0; i < (*new_P).m; i++) {
-		(*new_P).A[i] = calloc((*new_P).n, sizeof(double));
-		(*new_P).C[i] = calloc((*new_P).orig_m, sizeof(double));
-	}
-	
 	(*new_P).b = calloc((*new_P).m, sizeof(double));
+	(*new_P).p = calloc((*new_P).m, sizeof(int));
+	(*new_P).q = calloc((*new_P).m, sizeof(int));
+	(*new_P).scale = calloc((*new_P).m, sizeof(double));
+	(*new_P).var = calloc((*new_P).n, sizeof(int));
+	for (i = 0; i < (*new_P).n; i++)
+		(*new_P).var[i] = (*P).var[i+1];
+	if ((*P).H)
+		(*new_P).H = calloc((*new_P).m, sizeof(unsigned long*));
+
+	/* Split the new rows evenly over the threads. */
+	if (threads > (*new_P).m)
+		threads = ((*new_P).m ? (*new_P).m : 1);
+	for (t = 0; t < threads; t++) {
+		tasks[t].new_P = new_P;
+		tasks[t].first = (long) (*new_P).m * t / threads;
+		tasks[t].last = (long) (*new_P).m * (t + 1) / threads;
+	}
+	run_tasks(build_rows, tasks, threads);
+	free(tasks[0].keep);
+	free(tasks);
+	free(src);
+	free(offset);
+	free(pos);
+	free(neg);
+
+	normalize_LP(new_P);
+	if (options.prune) {
+		pruned = prune_LP(new_P);
+		fprintf(stderr, "Eliminated variable %d: %d rows left, %d combinations rejected "
+				"by Chernikov's rule, %d rows pruned\n",
+				(*new_P).level, (*new_P).m, rejected, pruned);
+	}
+	if (options.order)
+		order_LP(new_P);
+	count_types_LP(new_P);
+	return new_P;
+}
 
-	/* Set new equations */
+/* Helper for prune_LP: scale factor making the first
+ * non-zero coefficient of row i equal to 1 or -1,
+ * or 0 if all coefficients are zero. */
+double row_scale(LP *P, int i) {
+	int j;
+	for (j = 0; j < (*P).n; j++) {
+		if ((*P).A[i][j] != 0)
+			return fabs((*P).A[i][j]);
+	}
+	return 0;
+}
+
+/* Helper for prune_LP: whether row i comes from
+ * a subset of the original rows row j comes from. */
+int history_subset(LP *P, int i, int j) {
+	int k;
+	for (k = 0; k < HISTORY_WORDS((*P).orig_m); k++) {
+		if ((*P).H[i][k] & ~(*P).H[j][k])
+			return 0;
+	}
+	return 1;
+}
+
+/* Helper for prune_LP: hash of row i scaled by s, rounding
+ * the coefficients so that tiny differences do not matter. */
+unsigned long row_hash(LP *P, int i, double s) {
+	unsigned long h = 14695981039346656037UL, bits;
+	double r;
+	int j;
+	for (j = 0; j < (*P).n; j++) {
+		r = nearbyint((*P).A[i][j] / s * 1e6) + 0.0;
+		memcpy(&bits, &r, sizeof(bits));
+		h = (h ^ bits) * 1099511628211UL;
+	}
+	return h;
+}
+
+/* Remove rows that are implied by other rows: the ones
+ * reading 0 <= b with b >= 0, and multiples of other rows
+ * with a larger (scaled) b. Since the variables are free,
+ * these are the only rows dominated by a single other row.
+ * Return the number of removed rows. */
+int prune_LP(LP *P) {
+	int i, j, k, m, size, removed;
+	unsigned long h;
+	double s_i, s_j;
+
+	/* Open addressing hash table of rows, -1 is empty. */
+	size = 1;
+	while (size < 2 * (*P).m)
+		size *= 2;
+	int *table = malloc(size * sizeof(int));
+	for (k = 0; k < size; k++)
+		table[k] = -1;
+	char *removed_row = calloc((*P).m + 1, sizeof(char));
+
+	removed = 0;
 	for (i = 0; i < (*P).m; i++) {
-		for (j = 0; j < (*P).m; j++) {
-			/* Positive/negative pair, add equations. */
-			if ((*P).A[i][0] > 0 && (*P).A[j][0] < 0) {
-				/* Update A and b */
-				for (k = 0; k < (*new_P).n; k++) 
-					(*new_P).A[count][k] = (*P).A[i][k+1] + (*P).A[j][k+1];
-				(*new_P).b[count] = (*P).b[i] + (*P).b[j];
-				/* Update C */
-				for (k = 0; k < (*new_P).orig_m; k++)
-					(*new_P).C[count][k] = (*P).C[i][k] + (*P).C[j][k];
-				count ++;
-			}
-			/* Zero coefficient, just copy equation. */
-			if ((*P).A[i][0] == 0 && i == j) {
-				/* Update A and b */
-				for (k = 0; k < (*new_P).n; k++) 
-					(*new_P).A[count][k] = (*P).A[i][k+1];
-				(*new_P).b[count] = (*P).b[i];
-				/* Update C */
-				for (k = 0; k < (*new_P).orig_m; k++)
-					(*new_P).C[count][k] = (*P).C[i][k];
-				count ++;
+		s_i = row_scale(P, i);
+		/* Trivial row 0 <= b */
+		if (s_i == 0 && (*P).b[i] >= 0) {
+			removed_row[i] = 1;
+			removed++;
+			continue;
+		}
+		if (s_i == 0)
+			s_i = 1;
+		h = row_hash(P, i, s_i);
+		for (k = h & (size - 1); table[k] != -1; k = (k + 1) & (size - 1)) {
+			j = table[k];
+			s_j = row_scale(P, j);
+			if (s_j == 0)
+				s_j = 1;
+			for (m = 0; m < (*P).n; m++) {
+				if (fabs((*P).A[i][m] / s_i - (*P).A[j][m] / s_j) > 1e-9)
+					break;
 			}
+			if (m == (*P).n)
+				break;
+		}
+		if (table[k] == -1) {
+			table[k] = i;
+			continue;
+		}
+
+		/* Same row up to scaling: drop the looser one, but only
+		 * if the other comes from a subset of its original rows,
+		 * so that Chernikov's rule stays valid. */
+		j = table[k];
+		if ((*P).b[i] / s_i <= (*P).b[j] / s_j && history_subset(P, i, j)) {
+			table[k] = i;
+			removed_row[j] = 1;
+			removed++;
+		}
+		else if ((*P).b[j] / s_j <= (*P).b[i] / s_i && history_subset(P, j, i)) {
+			removed_row[i] = 1;
+			removed++;
 		}
 	}
-	normalize_LP(new_P);
-	count_types_LP(new_P);
-	return new_P;
+
+	/* Move the remaining rows to the front. */
+	m = 0;
+	for (i = 0; i < (*P).m; i++) {
+		if (removed_row[i]) {
+			free((*P).A[i]);
+			free((*P).H[i]);
+			continue;
+		}
+		(*P).A[m] = (*P).A[i];
+		(*P).H[m] = (*P).H[i];
+		(*P).b[m] = (*P).b[i];
+		(*P).p[m] = (*P).p[i];
+		(*P).q[m] = (*P).q[i];
+		(*P).scale[m] = (*P).scale[i];
+		m++;
+	}
+	(*P).m = m;
+	free(table);
+	free(removed_row);
+	return removed;
 }
 
-/* Prints the matrix A, C and vector b of an LP, as well 
- * as the number of positive, zero and negative coefficients
- * corresponding to the first variable */
+/* Write everything of P that is still needed to a file in
+ * options.spill, one block after the other: b, scale, the rows
+ * of A, p, q and var. Then replace P's data by a read-only
+ * mapping of the file, which the OS can page out when memory
+ * runs low. The file is removed right away: the mapping stays
+ * valid until free_LP. */
+void spill_LP(LP *P) {
+	char name[4096];
+	FILE *f;
+	char *map;
+	int i;
+	size_t size;
+	double *zero;
+
+	size = (size_t) (*P).m * ((*P).n + 2) * sizeof(double)
+			+ (2 * (size_t) (*P).m + (*P).n) * sizeof(int);
+	if (!size)
+		return;
+
+	zero = calloc((*P).n + 1, sizeof(double));
+	snprintf(name, sizeof(name), "%s/fm_%d_%d.tmp",
+			options.spill, (int) getpid(), (*P).level);
+	f = fopen(name, "w+b");
+	if (!f) {
+		fprintf(stderr, "Could not create %s: exiting...\n", name);
+		exit(1);
+	}
+	/* Released rows are written as zero rows, which
+	 * find_solution skips just the same. */
+	fwrite((*P).b, sizeof(double), (*P).m, f);
+	fwrite((*P).scale, sizeof(double), (*P).m, f);
+	for (i = 0; i < (*P).m; i++)
+		fwrite((*P).A[i] ? (*P).A[i] : zero, sizeof(double), (*P).n, f);
+	fwrite((*P).p, sizeof(int), (*P).m, f);
+	fwrite((*P).q, sizeof(int), (*P).m, f);
+	fwrite((*P).var, sizeof(int), (*P).n, f);
+	free(zero);
+	if (fflush(f) || ferror(f)) {
+		fprintf(stderr, "Could not write %s: exiting...\n", name);
+		exit(1);
+	}
+
+	map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "Could not map %s: exiting...\n", name);
+		exit(1);
+	}
+	fclose(f);
+	unlink(name);
+
+	/* Point the LP into the mapping. */
+	if ((*P).block) {
+		free((*P).block);
+		(*P).block = NULL;
+	}
+	else {
+		for (i = 0; i < (*P).m; i++)
+			free((*P).A[i]);
+	}
+	free((*P).b);
+	free((*P).scale);
+	free((*P).p);
+	free((*P).q);
+	free((*P).var);
+#ifdef __GLIBC__
+	/* Small blocks are not given back by free itself. */
+	malloc_trim(0);
+#endif
+	(*P).map = map;
+	(*P).map_size = size;
+	(*P).b = (double *) map;
+	(*P).scale = (*P).b + (*P).m;
+	for (i = 0; i < (*P).m; i++)
+		(*P).A[i] = (*P).scale + (*P).m + (size_t) i * (*P).n;
+	(*P).p = (int *) ((*P).scale + (*P).m + (size_t) (*P).m * (*P).n);
+	(*P).q = (*P).p + (*P).m;
+	(*P).var = (*P).q + (*P).m;
+}
+
+/* Move the variable whose elimination adds the fewest rows,
+ * n_pos*n_neg - n_pos - n_neg, to the first column, and
+ * normalize the LP again with respect to it. */
+void order_LP(LP *P) {
+	int i, j, best, *pos, *neg;
+	long growth, best_growth;
+	double t;
+
+	if ((*P).n < 2)
+		return;
+
+	/* Count the types of all columns at once. */
+	pos = calloc((*P).n, sizeof(int));
+	neg = calloc((*P).n, sizeof(int));
+	for (i = 0; i < (*P).m; i++) {
+		for (j = 0; j < (*P).n; j++) {
+			pos[j] += ((*P).A[i][j] > 0);
+			neg[j] += ((*P).A[i][j] < 0);
+		}
+	}
+	best = 0;
+	best_growth = (long) pos[0] * neg[0] - pos[0] - neg[0];
+	for (j = 1; j < (*P).n; j++) {
+		growth = (long) pos[j] * neg[j] - pos[j] - neg[j];
+		if (growth < best_growth) {
+			best = j;
+			best_growth = growth;
+		}
+	}
+	free(pos);
+	free(neg);
+	if (best == 0)
+		return;
+
+	for (i = 0; i < (*P).m; i++) {
+		t = (*P).A[i][0];
+		(*P).A[i][0] = (*P).A[i][best];
+		(*P).A[i][best] = t;
+	}
+	i = (*P).var[0];
+	(*P).var[0] = (*P).var[best];
+	(*P).var[best] = i;
+	normalize_LP(P);
+}
+
+/* Prints the matrix A and vector b of an LP, the rows each
+ * row is made of, as well as the number of positive, zero and
+ * negative coefficients corresponding to the first variable */
 void print_LP(LP *P) {
 	int i, j;
 
@@ -203,16 +732,28 @@ void print_LP(LP *P) {
      	}
   	}
     for (i = 0; i < (*P).m; i++) {
-    	if ((*P).orig_m > 0)
-   			printf("C[%d] = [", i);
-     	for (j = 0; j < (*P).orig_m; j++) {
-        	printf("%5.1lf%s", (*P).C[i][j], (j == (*P).orig_m-1 ? "]\n" : ", "));
-     	}
+    	printf("Row %d = %.3lf * (%d", i, (*P).scale[i], (*P).p[i]);
+    	if ((*P).q[i] != -1)
+    		printf(" + %d", (*P).q[i]);
+    	printf(")\n");
   	}
 
     printf("Types: %d - %d - %d\n", (*P).n_pos, (*P).n_zero, (*P).n_neg);
 }
 
+/* Helper for check_feasibility: index variable j of P
+ * had in the LP read, before presolving removed any. */
+int input_var(LP *P, int j) {
+	int k;
+	if (!(*P).ps)
+		return j;
+	for (k = 0; k < (*(*P).ps).n; k++) {
+		if ((*(*P).ps).col_alive[k] && j-- == 0)
+			return k;
+	}
+	return -1;
+}
+
 /* Check whether an LP is feasible by reducing it to
  * an equivalent system in zero variables and then 
  * checking b >= 0. Depending on feasibility, a
@@ -221,6 +762,15 @@ void check_feasibility(LP *P, int verbose) {
 	int i;
 	double *sol, cert;
 
+	/* Presolving may have shown the LP to be infeasible */
+	if ((*P).ps && (*(*P).ps).certificate) {
+		sol = malloc(((*(*P).ps).m + 1) * sizeof(double));
+		memcpy(sol, (*(*P).ps).certificate, (*(*P).ps).m * sizeof(double));
+		print_weights(sol, (*(*P).ps).m);
+		free_LP(P);
+		return;
+	}
+
 	/* red will contain a sequence of n+1 LPs equivalent
 	 * to P, such that red[i] has one fewer variable 
 	 * than red[i-1]. */
@@ -232,7 +782,12 @@ void check_feasibility(LP *P, int verbose) {
 
 	/* Reduce P, save each intermediate LP */
 	for (i = 1; i < (*P).n + 1; i++) {
+		if (options.order)
+			fprintf(stderr, "Eliminating x%d\n", input_var(P, (*red[i-1]).var[0]) + 1);
 		red[i] = eliminate_variable(red[i-1]);
+		release_rows(red[i-1]);
+		if (options.spill)
+			spill_LP(red[i-1]);
 		if (verbose) 
 			print_LP(red[i]);
 	}
@@ -241,15 +796,22 @@ void check_feasibility(LP *P, int verbose) {
 	for (i = 0; i < (*red[(*P).n]).m; i++) {
 		/* If b[i] < 0, the system is infeasible,
 		 * and a certificate is provided by the 
-		 * i-th row of C */
+		 * combination giving the i-th row */
 		if ((*red[(*P).n]).b[i] < 0) {
-			print_certificate(red[(*P).n], i);
+			print_certificate(red, (*P).n, i);
 			free_sequence(red);
 			return;
 		}
 	}
 	/* If b>=0, a solution can be found by back-substitution */
-	print_solution(find_solution(red), (*P).n);
+	sol = find_solution(red);
+	if ((*P).ps) {
+		double *orig_sol = postsolve_solution((*P).ps, sol);
+		free(sol);
+		print_solution(orig_sol, (*(*P).ps).n);
+	}
+	else
+		print_solution(sol, (*P).n);
 	free_sequence(red);
 }
 
@@ -284,12 +846,11 @@ void normalize_LP(LP *P) {
 
 	for (i = 0; i < (*P).m; i++) {
 		/* If first coefficient is non-zero, we can normalize. */
-		if (t = abs((*P).A[i][0])) {
+		if (t = fabs((*P).A[i][0])) {
 			(*P).b[i] /= t;
 			for (j = 0; j < (*P).n; j++)
 				(*P).A[i][j] /= t;
-			for (j = 0; j < (*P).orig_m; j++)
-				(*P).C[i][j] /= t;
+			(*P).scale[i] /= t;
 		}
 	}
 }
@@ -301,43 +862,103 @@ LP *get_LP(const char *filename) {
 	LP *P = calloc(1, sizeof(LP));
 	
 	/* Read file */
-	read_LP(filename, &((*P).m),
+	/* In MPS files, variables are non-negative unless
+	 * bounded otherwise, so all bounds are needed as rows. */
+	SparseLP lp;
+	if (is_MPS(filename)) {
+		if (read_MPS(filename, 1, &lp) != EXIT_SUCCESS ||
+				sparse_LP_to_dense(&lp, &(*P).m, &(*P).n, &(*P).A,
+				&(*P).b, &(*P).c) != EXIT_SUCCESS)
+			exit(EXIT_FAILURE);
+		free_sparse_LP(&lp);
+	}
+	else if (read_LP(filename, &((*P).m),
 			&(*P).n, &(*P).A,
-			&(*P).b, &(*P).c);
+			&(*P).b, &(*P).c) != EXIT_SUCCESS)
+		exit(EXIT_FAILURE);
+	(*P).block = (*P).A[0];
+
+	/* Replace the LP by the presolved one, which keeps
+	 * what is needed to map the results back */
+	if (options.presolve) {
+		int result, m, n;
+		double **A, *b, *c;
+		(*P).ps = presolve_LP((*P).m, (*P).n, (*P).A, (*P).b,
+				NULL, PRESOLVE_LE, PRESOLVE_FREE, &result);
+		print_presolve_stats((*P).ps, stderr);
+		if (presolved_LP((*P).ps, &m, &n, &A, &b, &c) != EXIT_SUCCESS)
+			exit(EXIT_FAILURE);
+		release_memory((*P).A, (*P).b, (*P).c);
+		(*P).m = m;
+		(*P).n = n;
+		(*P).A = A;
+		(*P).block = A[0];
+		(*P).b = b;
+		(*P).c = c;
+	}
 	/* We don't need c, free it right away. */
 	free((*P).c);
 
-	/* Set C to mxm identity. */
+	/* Row i is the i-th original row. */
 	(*P).orig_m = (*P).m;
-	(*P).C = calloc((*P).m, sizeof(double*));
+	(*P).p = calloc((*P).m, sizeof(int));
+	(*P).q = calloc((*P).m, sizeof(int));
+	(*P).scale = calloc((*P).m, sizeof(double));
 	for (i = 0; i < (*P).m; i++) {
-		(*P).C[i] = calloc((*P).m, sizeof(double*));
-		(*P).C[i][i] = 1;
+		(*P).p[i] = i;
+		(*P).q[i] = -1;
+		(*P).scale[i] = 1;
+	}
+	(*P).var = calloc((*P).n, sizeof(int));
+	for (i = 0; i < (*P).n; i++)
+		(*P).var[i] = i;
+	if (options.prune) {
+		(*P).H = calloc((*P).m, sizeof(unsigned long*));
+		for (i = 0; i < (*P).m; i++) {
+			(*P).H[i] = calloc(HISTORY_WORDS((*P).m), sizeof(unsigned long));
+			(*P).H[i][i / 64] = 1UL << (i % 64);
+		}
 	}
 
 	normalize_LP(P);
+	if (options.order)
+		order_LP(P);
 	count_types_LP(P);
 	return P;
 }
 
 int main(int argc, const char *argv[]){
+	int i;
 	
 	/* Check if enough arguments were given */
 	if (argc < 2) {
-    	fprintf(stderr, "Usage:  %s  <lp file> [verbose]\n", argv[0]);
+    	fprintf(stderr, "Usage:  %s  <lp file> [-t threads] [-p] [-o] [-s dir] [-P] [verbose]\n", argv[0]);
       	return EXIT_FAILURE;
    	}
 
-   	/* If a third argument is given, 
-   	 * print all reduction steps */
-   	int verbose;
-   	if (argc > 2)
-   		verbose = 1;
-   	else
-   		verbose = 0;
+   	/* -t n combines rows using n threads, -p prunes
+   	 * redundant rows after each step, -o picks the
+   	 * order in which the variables are eliminated, -s dir
+   	 * keeps the intermediate LPs in files in dir instead
+   	 * of in memory, -P presolves the LP first. Any other
+   	 * argument prints all reduction steps */
+   	for (i = 2; i < argc; i++) {
+   		if (!strcmp(argv[i], "-t") && i + 1 < argc)
+   			options.threads = atoi(argv[++i]);
+   		else if (!strcmp(argv[i], "-p"))
+   			options.prune = 1;
+   		else if (!strcmp(argv[i], "-o"))
+   			options.order = 1;
+   		else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+   			options.spill = argv[++i];
+   		else if (!strcmp(argv[i], "-P"))
+   			options.presolve = 1;
+   		else
+   			options.verbose = 1;
+   	}
 
    	/* Read LP from the file and check if feasible */
     LP *P = get_LP(argv[1]);
-    check_feasibility(P, verbose);
+    check_feasibility(P, options.verbose);
     return EXIT_SUCCESS;
 }
\ No newline at end of file
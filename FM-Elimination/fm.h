@@ -9,8 +9,21 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "LP_reader.h"
+#include "MPS_reader.h"
+#include "presolve.h"
+
+/* Sums of two coefficients of at most this times the size
+ * of the coefficients added count as zero, see build_rows */
+#define CANCEL_TOL 1e-12
+
+/* Most rows an eliminated LP may have, see eliminate_variable */
+#define MAX_ROWS 1000000
+
+/* Number of words in the history of a row, see LP */
+#define HISTORY_WORDS(orig_m) (((orig_m) + 63) / 64)
 
 /* Basic struct for LPs. */
 typedef struct {
@@ -19,32 +32,108 @@ typedef struct {
 	int m;
 	int n;
     double **A;
+    /* If not NULL, the rows of A are stored in this one
+     * block, as read by read_LP, and not freed one by one */
+    double *block;
     double *b;
     double *c;
 
-    /* Matrix used to keep track of the linear
-     * combinations used to find new inequalities.
-     * Needed to find certificates */
-    double **C;
+    /* Keep track of the linear combinations used to
+     * find new inequalities, needed to find certificates:
+     * row i is scale[i] times the sum of the rows p[i] and
+     * q[i] (if not -1) of the previous LP in the sequence,
+     * or of the original LP if level is 0. */
+    int *p;
+    int *q;
+    double *scale;
 	int orig_m;
 
+	/* The original rows each row comes from, as sets of
+	 * orig_m bits (see HISTORY_WORDS). Only kept when
+	 * pruning, otherwise NULL. */
+	unsigned long **H;
+
 	/* Amount of positive, zero, and negative 
 	 * coefficients in A corresponding to the
 	 * first variable */
     int n_pos;
     int n_zero;
     int n_neg;
+
+    /* Number of variables eliminated to get this LP */
+    int level;
+
+    /* Original index of the variable in each column */
+    int *var;
+
+    /* If not NULL, the LP was spilled to a file and A, b,
+     * p, q, scale and var point into this read-only mapping
+     * of map_size bytes, see spill_LP */
+    void *map;
+    size_t map_size;
+
+    /* If not NULL, this LP is the presolved version of the
+     * LP read, and solutions and certificates are mapped
+     * back to it with ps, see get_LP */
+    Presolve *ps;
 } LP;
 
+/* Options given on the command line. */
+typedef struct {
+	int verbose;
+	/* Number of threads used to build the
+	 * rows of each eliminated LP */
+	int threads;
+	/* Remove redundant rows after each step */
+	int prune;
+	/* Eliminate the variable adding the fewest
+	 * rows first, instead of the first one */
+	int order;
+	/* Directory to spill the intermediate LPs
+	 * to, or NULL to keep them in memory */
+	const char *spill;
+	/* Presolve the LP before eliminating */
+	int presolve;
+} Options;
+
+extern Options options;
+
+/* Part of the rows of an eliminated LP, built by one thread.
+ * Source row src[k] of P gives the rows offset[k], ...,
+ * offset[k+1]-1 of new_P: one per row in neg if its first
+ * coefficient is positive, or a copy if it is zero. If keep
+ * is set, only the pairs with keep[pos[k]*n_neg + p] != 0 are
+ * used, where pos[k] numbers the source rows with a positive
+ * first coefficient. */
+typedef struct {
+	LP *P;
+	LP *new_P;
+	int *src;
+	int *offset;
+	int *neg;
+	int *pos;
+	char *keep;
+	int first;	/* Rows first, ..., last-1 of new_P, or */
+	int last;	/* source rows when counting pairs */
+	int rejected;
+} RowTask;
+
 LP *eliminate_variable(LP*);
-LP *get_LP(const char*);
+void *build_rows(void*);
+void *count_pairs(void*);
+void run_tasks(void *(*)(void*), RowTask*, int);
+int prune_LP(LP*);
+void release_rows(LP*);
+void order_LP(LP*);
+void spill_LP(LP*);
 
 void build_LP(LP*);
 void print_LP(LP*);
 void count_types_LP(LP*);
 void normalize_LP(LP*);
 void print_solution(double*, int);
-void print_certificate(LP*, int);
+void print_weights(double*, int);
+void print_certificate(LP**, int, int);
 void check_feasibility(LP*, int);
 
 double *find_solution(LP**);
@@ -0,0 +1,915 @@
+#include "MPS_reader.h"
+#include "presolve.h"
+
+#include <math.h>
+#include <string.h>
+
+/* Reductions that change the solution, see Reduction. Rows
+   that are simply dropped need nothing to be undone. */
+#define REDUCTION_FIX  0   /* Column fixed to value */
+#define REDUCTION_FREE 1   /* Free column with entries of one sign,
+                              removed with its rows, see
+                              remove_free_column */
+
+/* Rows with the same pattern of non-zero entries get the same
+   key, see duplicate_rows. */
+typedef struct {
+   unsigned long key;
+   int           row;
+} RowKey;
+
+/* Bounds on the variables given by the singleton rows (and
+   x >= 0). lower_row and upper_row are the rows giving them,
+   or -1. */
+typedef struct {
+   double * lower;
+   double * upper;
+   int *    lower_row;
+   int *    upper_row;
+} Bounds;
+
+void push_reduction(Presolve * ps, const Reduction * r)
+{
+   if (ps->depth == ps->capacity) {
+      ps->capacity = 2 * ps->capacity + 8;
+      ps->stack = realloc(ps->stack, ps->capacity * sizeof(Reduction));
+   }
+   ps->stack[ps->depth++] = *r;
+}
+
+/* Return the entry of A in row i and column j, by a binary
+   search among the sorted rows of column j. */
+double get_entry(const Presolve * ps, int i, int j)
+{
+   unsigned int lo = ps->col_start[j];
+   unsigned int hi = ps->col_start[j + 1];
+   unsigned int mid;
+
+   while (lo < hi) {
+      mid = lo + (hi - lo) / 2;
+      if ((int) ps->row_index[mid] < i) {
+         lo = mid + 1;
+      }
+      else {
+         hi = mid;
+      }
+   }
+   if (lo < ps->col_start[j + 1] && (int) ps->row_index[lo] == i) {
+      return ps->col_values[lo];
+   }
+   return 0;
+}
+
+/* Return the number of non-zero entries of row i in the
+   remaining columns, and store the column of the last one. */
+int row_count(const Presolve * ps, int i, int * col)
+{
+   unsigned int k;
+   int          count = 0;
+
+   for (k = ps->row_start[i]; k < ps->row_start[i + 1]; k++) {
+      if (ps->col_alive[ps->col_index[k]]) {
+         *col = ps->col_index[k];
+         count++;
+      }
+   }
+   return count;
+}
+
+void remove_row(Presolve * ps, int i)
+{
+   ps->row_alive[i] = 0;
+   ps->removed_rows++;
+}
+
+/* Fix x_j to value and move it to the right-hand side. lower
+   and upper are the rows that fixed it, if any, which are
+   needed to undo this in a certificate. */
+void fix_column(Presolve * ps, int j, double value, int lower, int upper)
+{
+   Reduction    r;
+   unsigned int k;
+
+   memset(&r, 0, sizeof(Reduction));
+   r.type = REDUCTION_FIX;
+   r.col = j;
+   r.value = value;
+   r.lower = lower;
+   r.upper = upper;
+   push_reduction(ps, &r);
+
+   for (k = ps->col_start[j]; k < ps->col_start[j + 1]; k++) {
+      if (ps->row_alive[ps->row_index[k]]) {
+         ps->b[ps->row_index[k]] -= ps->col_values[k] * value;
+      }
+   }
+   ps->col_alive[j] = 0;
+   ps->removed_cols++;
+}
+
+/* Remove a free column whose entries all have the same sign,
+   together with all rows it appears in: x_j can always be
+   chosen to satisfy them, once the other variables are known.
+   The rows and their right-hand sides are kept for
+   postsolve_solution. */
+void remove_free_column(Presolve * ps, int j, int count)
+{
+   Reduction    r;
+   unsigned int k;
+   int          i;
+
+   memset(&r, 0, sizeof(Reduction));
+   r.type = REDUCTION_FREE;
+   r.col = j;
+   r.lower = -1;
+   r.upper = -1;
+   r.count = count;
+   r.rows = malloc(count * sizeof(int));
+   r.b = malloc(count * sizeof(double));
+
+   count = 0;
+   for (k = ps->col_start[j]; k < ps->col_start[j + 1]; k++) {
+      i = ps->row_index[k];
+      if (!ps->row_alive[i]) {
+         continue;
+      }
+      r.rows[count] = i;
+      r.b[count] = ps->b[i];
+      remove_row(ps, i);
+      count++;
+   }
+   push_reduction(ps, &r);
+   ps->col_alive[j] = 0;
+   ps->removed_cols++;
+}
+
+/* Record that the rows i and k (if not -1) combined with the
+   weights wi and wk give 0 <= (something negative). The
+   weights are scaled to at most 1, which keeps them readable
+   when printed. */
+void set_infeasible(Presolve * ps, int i, double wi, int k, double wk)
+{
+   double max = fmax(wi, wk);
+
+   if (ps->rows == PRESOLVE_LE && ps->vars == PRESOLVE_FREE) {
+      ps->certificate = calloc(ps->m + 1, sizeof(double));
+      ps->certificate[i] = wi / max;
+      if (k != -1) {
+         ps->certificate[k] = wk / max;
+      }
+   }
+}
+
+/* Remove the rows without entries. Return -1 if one of them
+   is infeasible, else the number of rows removed. */
+int empty_rows(Presolve * ps)
+{
+   int i;
+   int j;
+   int removed = 0;
+
+   for (i = 0; i < ps->m; i++) {
+      if (!ps->row_alive[i] || row_count(ps, i, &j) != 0) {
+         continue;
+      }
+      if (ps->b[i] < -PRESOLVE_TOL ||
+          (ps->rows == PRESOLVE_EQ && ps->b[i] > PRESOLVE_TOL)) {
+         set_infeasible(ps, i, 1, -1, 0);
+         return -1;
+      }
+      remove_row(ps, i);
+      ps->empty++;
+      removed++;
+   }
+   return removed;
+}
+
+/* Find the bounds given by the singleton rows. Singleton
+   equality rows fix their variable right away, singleton rows
+   implied by x >= 0 are removed. Return -1 if the bounds
+   contradict each other, else the number of changes. */
+int singleton_rows(Presolve * ps, Bounds * bd)
+{
+   int    i;
+   int    j;
+   int    changes = 0;
+   double a;
+   double value;
+
+   for (j = 0; j < ps->n; j++) {
+      bd->lower[j] = (ps->vars == PRESOLVE_FREE ? -INFINITY : 0);
+      bd->upper[j] = INFINITY;
+      bd->lower_row[j] = -1;
+      bd->upper_row[j] = -1;
+   }
+   for (i = 0; i < ps->m; i++) {
+      if (!ps->row_alive[i] || row_count(ps, i, &j) != 1) {
+         continue;
+      }
+      a = get_entry(ps, i, j);
+      value = ps->b[i] / a;
+      if (ps->rows == PRESOLVE_EQ) {
+         if (ps->vars == PRESOLVE_NONNEG && value < 0) {
+            if (value < -PRESOLVE_TOL) {
+               return -1;
+            }
+            value = 0;
+         }
+         fix_column(ps, j, value, -1, -1);
+         remove_row(ps, i);
+         ps->fixed++;
+         changes++;
+      }
+      else if (a < 0 && ps->vars == PRESOLVE_NONNEG && value <= 0) {
+         remove_row(ps, i);
+         ps->redundant++;
+         changes++;
+      }
+      else if (a > 0 && value < bd->upper[j]) {
+         bd->upper[j] = value;
+         bd->upper_row[j] = i;
+      }
+      else if (a < 0 && value > bd->lower[j]) {
+         bd->lower[j] = value;
+         bd->lower_row[j] = i;
+      }
+   }
+
+   /* Fix the variables whose bounds meet, dropping the rows
+      giving the bounds */
+   for (j = 0; j < ps->n && ps->rows == PRESOLVE_LE; j++) {
+      if (!ps->col_alive[j] || bd->upper[j] == INFINITY) {
+         continue;
+      }
+      if (bd->lower[j] > bd->upper[j] + PRESOLVE_TOL) {
+         i = bd->lower_row[j];
+         if (i == -1) {
+            set_infeasible(ps, bd->upper_row[j],
+                           1 / get_entry(ps, bd->upper_row[j], j), -1, 0);
+         }
+         else {
+            set_infeasible(ps, i, -1 / get_entry(ps, i, j), bd->upper_row[j],
+                           1 / get_entry(ps, bd->upper_row[j], j));
+         }
+         return -1;
+      }
+      if (bd->lower[j] >= bd->upper[j] - PRESOLVE_TOL) {
+         value = fmax(bd->upper[j], bd->lower[j]);
+         fix_column(ps, j, value, bd->lower_row[j], bd->upper_row[j]);
+         remove_row(ps, bd->upper_row[j]);
+         if (bd->lower_row[j] != -1) {
+            remove_row(ps, bd->lower_row[j]);
+         }
+         ps->fixed++;
+         changes++;
+      }
+   }
+   return changes;
+}
+
+int compare_row_keys(const void * p, const void * q)
+{
+   const RowKey * r = p;
+   const RowKey * s = q;
+
+   if (r->key != s->key) {
+      return (r->key < s->key ? -1 : 1);
+   }
+   return r->row - s->row;
+}
+
+/* Return l such that row k is l times row i, or 0 if there is
+   no such l. The two rows are walked through side by side, in
+   the order of their columns. */
+double row_ratio(const Presolve * ps, int i, int k)
+{
+   unsigned int p = ps->row_start[i];
+   unsigned int q = ps->row_start[k];
+   unsigned int p_end = ps->row_start[i + 1];
+   unsigned int q_end = ps->row_start[k + 1];
+   unsigned int j;
+   double       a;
+   double       b;
+   double       l = 0;
+
+   while (p < p_end || q < q_end) {
+      if (q == q_end || (p < p_end && ps->col_index[p] <= ps->col_index[q])) {
+         j = ps->col_index[p];
+      }
+      else {
+         j = ps->col_index[q];
+      }
+      a = (p < p_end && ps->col_index[p] == j ? ps->row_values[p++] : 0);
+      b = (q < q_end && ps->col_index[q] == j ? ps->row_values[q++] : 0);
+      if (!ps->col_alive[j]) {
+         continue;
+      }
+      if ((a == 0) != (b == 0)) {
+         return 0;
+      }
+      if (l == 0) {
+         l = b / a;
+      }
+      if (fabs(b - l * a) > PRESOLVE_TOL * (1 + fabs(b))) {
+         return 0;
+      }
+   }
+   return l;
+}
+
+/* Remove the rows parallel to another row: of two inequalities
+   pointing the same way the weaker one, and of two equalities
+   either one. Return -1 if two rows contradict each other, else
+   the number of rows removed. */
+int duplicate_rows(Presolve * ps)
+{
+   RowKey *     keys = malloc((ps->m + 1) * sizeof(RowKey));
+   int          count = 0;
+   int          removed = 0;
+   unsigned int p;
+   int          i;
+   int          j;
+   int          k;
+   int          s;
+   int          t;
+   double       l;
+
+   /* Sort the rows by their pattern, so parallel rows are
+      next to each other */
+   for (i = 0; i < ps->m; i++) {
+      if (!ps->row_alive[i]) {
+         continue;
+      }
+      keys[count].key = 0;
+      for (p = ps->row_start[i]; p < ps->row_start[i + 1]; p++) {
+         if (ps->col_alive[ps->col_index[p]]) {
+            keys[count].key = keys[count].key * 31 + ps->col_index[p] + 1;
+         }
+      }
+      keys[count].row = i;
+      count++;
+   }
+   qsort(keys, count, sizeof(RowKey), compare_row_keys);
+
+   for (s = 0; s < count; s++) {
+      i = keys[s].row;
+      for (t = s + 1; t < count && keys[t].key == keys[s].key; t++) {
+         k = keys[t].row;
+         if (!ps->row_alive[i] || !ps->row_alive[k] ||
+             (l = row_ratio(ps, i, k)) == 0) {
+            continue;
+         }
+         if (ps->rows == PRESOLVE_EQ) {
+            if (fabs(ps->b[k] - l * ps->b[i]) >
+                PRESOLVE_TOL * (1 + fabs(ps->b[k]))) {
+               free(keys);
+               return -1;
+            }
+            remove_row(ps, k);
+         }
+         else if (l < 0) {
+            /* Row i plus row k / |l| is 0 <= b_i + b_k / |l| */
+            if (ps->b[i] - ps->b[k] / l < -PRESOLVE_TOL) {
+               set_infeasible(ps, i, 1, k, -1 / l);
+               free(keys);
+               return -1;
+            }
+            continue;
+         }
+         else {
+            remove_row(ps, ps->b[k] / l < ps->b[i] ? i : k);
+         }
+         if (row_count(ps, k, &j) == 1) {
+            ps->tightened++;
+         }
+         else {
+            ps->duplicates++;
+         }
+         removed++;
+      }
+   }
+   free(keys);
+   return removed;
+}
+
+/* Remove the empty columns and the columns that can be left at
+   their bound: for x >= 0 those with c_j <= 0 and no negative
+   entries in inequalities. Free columns whose entries all have
+   the same sign are removed with their rows. Equalities keep
+   their empty columns, so that the reduced LP never has more
+   rows than columns if the original one did not. Return the
+   number of columns removed. */
+int dominated_columns(Presolve * ps)
+{
+   unsigned int k;
+   int          j;
+   int          pos;
+   int          neg;
+   int          removed = 0;
+
+   for (j = 0; j < ps->n; j++) {
+      if (!ps->col_alive[j]) {
+         continue;
+      }
+      pos = 0;
+      neg = 0;
+      for (k = ps->col_start[j]; k < ps->col_start[j + 1]; k++) {
+         if (ps->row_alive[ps->row_index[k]]) {
+            pos += (ps->col_values[k] > 0);
+            neg += (ps->col_values[k] < 0);
+         }
+      }
+      if (ps->vars == PRESOLVE_FREE) {
+         if (pos + neg == 0) {
+            fix_column(ps, j, 0, -1, -1);
+            ps->empty++;
+         }
+         else if ((pos == 0 || neg == 0) && ps->rows == PRESOLVE_LE) {
+            remove_free_column(ps, j, pos + neg);
+            ps->dominated++;
+         }
+         else {
+            continue;
+         }
+      }
+      else {
+         if ((ps->c && ps->c[j] > 0) || ps->rows == PRESOLVE_EQ ||
+             neg > 0) {
+            continue;
+         }
+         fix_column(ps, j, 0, -1, -1);
+         if (pos + neg == 0) {
+            ps->empty++;
+         }
+         else {
+            ps->dominated++;
+         }
+      }
+      removed++;
+   }
+   return removed;
+}
+
+/* Remove the inequalities (other than the bounds themselves)
+   that hold for all x within the bounds. Return the number of
+   rows removed. */
+int redundant_rows(Presolve * ps, const Bounds * bd)
+{
+   unsigned int k;
+   int          i;
+   int          j;
+   int          removed = 0;
+   double       a;
+   double       max;
+
+   if (ps->rows != PRESOLVE_LE) {
+      return 0;
+   }
+   for (i = 0; i < ps->m; i++) {
+      if (!ps->row_alive[i] || row_count(ps, i, &j) < 2) {
+         continue;
+      }
+      max = 0;
+      for (k = ps->row_start[i]; k < ps->row_start[i + 1] && max < INFINITY; k++) {
+         j = ps->col_index[k];
+         a = ps->row_values[k];
+         if (!ps->col_alive[j]) {
+            continue;
+         }
+         max += (a > 0 ? a * bd->upper[j] : a * bd->lower[j]);
+      }
+      if (max <= ps->b[i]) {
+         remove_row(ps, i);
+         ps->redundant++;
+         removed++;
+      }
+   }
+   return removed;
+}
+
+/* Undo the reductions in a certificate y for the reduced LP,
+   given with one weight for each original row. Moving a fixed
+   variable to the right-hand side is undone by adding the rows
+   that fixed it, so its column sums to zero again. */
+void undo_certificate(const Presolve * ps, double * y)
+{
+   const Reduction * r;
+   unsigned int      k;
+   int               d;
+   double            s;
+
+   for (d = ps->depth - 1; d >= 0; d--) {
+      r = &ps->stack[d];
+      if (r->type != REDUCTION_FIX) {
+         continue;
+      }
+      s = 0;
+      for (k = ps->col_start[r->col]; k < ps->col_start[r->col + 1]; k++) {
+         s += y[ps->row_index[k]] * ps->col_values[k];
+      }
+      if (s > 0 && r->lower != -1) {
+         y[r->lower] += s / -get_entry(ps, r->lower, r->col);
+      }
+      else if (s < 0 && r->upper != -1) {
+         y[r->upper] += -s / get_entry(ps, r->upper, r->col);
+      }
+   }
+}
+
+/* Apply each reduction once. Return -1 if the LP turned out
+   to be infeasible, else the number of changes. */
+int presolve_pass(Presolve * ps, Bounds * bd)
+{
+   int changes = 0;
+   int i;
+
+   if ((i = empty_rows(ps)) == -1) {
+      return -1;
+   }
+   changes += i;
+   if ((i = singleton_rows(ps, bd)) == -1) {
+      return -1;
+   }
+   changes += i;
+   if ((i = duplicate_rows(ps)) == -1) {
+      return -1;
+   }
+   changes += i;
+   changes += dominated_columns(ps);
+
+   /* The bounds may have changed */
+   if ((i = singleton_rows(ps, bd)) == -1) {
+      return -1;
+   }
+   changes += i;
+   return changes + redundant_rows(ps, bd);
+}
+
+/* Helper for presolve_LP and presolve_sparse_LP: once the rows
+   of A are stored in ps, add the columns and the rest of the LP,
+   and apply the reductions until none of them changes anything,
+   as each one can make room for the others. */
+Presolve *presolve_rows(Presolve *     ps,
+                        const double * b,
+                        const double * c,
+                        int            rows,
+                        int            vars,
+                        int *          result)
+{
+   Bounds       bd;
+   unsigned int k;
+   int          changes;
+   int          i;
+   int          j;
+
+   ps->rows = rows;
+   ps->vars = vars;
+
+   /* Sort the entries into columns, by row */
+   ps->col_start = calloc(ps->n + 2, sizeof(unsigned int));
+   ps->row_index = malloc((ps->row_start[ps->m] + 1) * sizeof(unsigned int));
+   ps->col_values = malloc((ps->row_start[ps->m] + 1) * sizeof(double));
+   for (k = 0; k < ps->row_start[ps->m]; k++) {
+      ps->col_start[ps->col_index[k] + 2]++;
+   }
+   for (j = 0; j < ps->n; j++) {
+      ps->col_start[j + 2] += ps->col_start[j + 1];
+   }
+   for (i = 0; i < ps->m; i++) {
+      for (k = ps->row_start[i]; k < ps->row_start[i + 1]; k++) {
+         j = ps->col_index[k] + 1;
+         ps->row_index[ps->col_start[j]] = i;
+         ps->col_values[ps->col_start[j]++] = ps->row_values[k];
+      }
+   }
+
+   ps->b = malloc((ps->m + 1) * sizeof(double));
+   memcpy(ps->b, b, ps->m * sizeof(double));
+   if (c) {
+      ps->c = malloc((ps->n + 1) * sizeof(double));
+      memcpy(ps->c, c, ps->n * sizeof(double));
+   }
+   ps->row_alive = malloc(ps->m + 1);
+   ps->col_alive = malloc(ps->n + 1);
+   memset(ps->row_alive, 1, ps->m);
+   memset(ps->col_alive, 1, ps->n);
+
+   bd.lower = malloc((ps->n + 1) * sizeof(double));
+   bd.upper = malloc((ps->n + 1) * sizeof(double));
+   bd.lower_row = malloc((ps->n + 1) * sizeof(int));
+   bd.upper_row = malloc((ps->n + 1) * sizeof(int));
+
+   do {
+      changes = presolve_pass(ps, &bd);
+   } while (changes > 0);
+   *result = (changes == -1 ? PRESOLVE_INFEASIBLE : PRESOLVE_OK);
+
+   if (ps->certificate) {
+      undo_certificate(ps, ps->certificate);
+   }
+   free(bd.lower);
+   free(bd.upper);
+   free(bd.lower_row);
+   free(bd.upper_row);
+   return ps;
+}
+
+Presolve *presolve_LP(int      m,
+                      int      n,
+                      double **A,
+                      double * b,
+                      double * c,
+                      int      rows,
+                      int      vars,
+                      int *    result)
+{
+   Presolve *   ps = calloc(1, sizeof(Presolve));
+   unsigned int k;
+   int          i;
+   int          j;
+
+   /* Keep the non-zero entries of A, row by row */
+   ps->m = m;
+   ps->n = n;
+   ps->row_start = malloc((m + 1) * sizeof(unsigned int));
+   ps->row_start[0] = 0;
+   for (i = 0; i < m; i++) {
+      ps->row_start[i + 1] = ps->row_start[i];
+      for (j = 0; j < n; j++) {
+         ps->row_start[i + 1] += (A[i][j] != 0);
+      }
+   }
+   ps->col_index = malloc((ps->row_start[m] + 1) * sizeof(unsigned int));
+   ps->row_values = malloc((ps->row_start[m] + 1) * sizeof(double));
+   k = 0;
+   for (i = 0; i < m; i++) {
+      for (j = 0; j < n; j++) {
+         if (A[i][j] != 0) {
+            ps->col_index[k] = j;
+            ps->row_values[k++] = A[i][j];
+         }
+      }
+   }
+   return presolve_rows(ps, b, c, rows, vars, result);
+}
+
+/* Same as presolve_LP, for an LP given in compressed sparse
+   columns. Its arrays are only read. */
+Presolve *presolve_sparse_LP(const SparseLP * lp,
+                             int              rows,
+                             int              vars,
+                             int *            result)
+{
+   Presolve *   ps = calloc(1, sizeof(Presolve));
+   unsigned int k;
+   int          i;
+   int          j;
+
+   /* Sort the non-zero entries into rows, by column */
+   ps->m = lp->m;
+   ps->n = lp->n;
+   ps->row_start = calloc(lp->m + 2, sizeof(unsigned int));
+   for (k = 0; k < lp->col_start[lp->n]; k++) {
+      ps->row_start[lp->row_index[k] + 2] += (lp->values[k] != 0);
+   }
+   for (i = 0; i < lp->m; i++) {
+      ps->row_start[i + 2] += ps->row_start[i + 1];
+   }
+   ps->col_index = malloc((ps->row_start[lp->m + 1] + 1) * sizeof(unsigned int));
+   ps->row_values = malloc((ps->row_start[lp->m + 1] + 1) * sizeof(double));
+   for (j = 0; j < lp->n; j++) {
+      for (k = lp->col_start[j]; k < lp->col_start[j + 1]; k++) {
+         if (lp->values[k] != 0) {
+            i = lp->row_index[k] + 1;
+            ps->col_index[ps->row_start[i]] = j;
+            ps->row_values[ps->row_start[i]++] = lp->values[k];
+         }
+      }
+   }
+   return presolve_rows(ps, lp->b, lp->c, rows, vars, result);
+}
+
+/* Store the index each remaining row (or column) has in the
+   reduced LP in index, or -1, and return their number. */
+int reduced_indices(const char * alive, int size, int * index)
+{
+   int i;
+   int count = 0;
+
+   for (i = 0; i < size; i++) {
+      index[i] = (alive[i] ? count++ : -1);
+   }
+   return count;
+}
+
+int presolved_LP(const Presolve * ps,
+                 int *            m,
+                 int *            n,
+                 double ***       A,
+                 double **        b,
+                 double **        c)
+{
+   int *        col = malloc((ps->n + 1) * sizeof(int));
+   unsigned int k;
+   int          i;
+   int          l;
+
+   *m = ps->m - ps->removed_rows;
+   *n = ps->n - ps->removed_cols;
+   *b = malloc((*m + 1) * sizeof(double));
+   *c = calloc(*n + 1, sizeof(double));
+   *A = calloc(*m ? *m : 1, sizeof(double*));
+   if (!col || !*b || !*c || !*A ||
+       !((*A)[0] = calloc((size_t) *m * *n + 1, sizeof(double)))) {
+      fprintf(stderr, "Memory allocation failure.\n");
+      free(col);
+      free(*A);
+      free(*b);
+      free(*c);
+      return EXIT_FAILURE;
+   }
+
+   reduced_indices(ps->col_alive, ps->n, col);
+   l = 0;
+   for (i = 0; i < ps->m; i++) {
+      if (!ps->row_alive[i]) {
+         continue;
+      }
+      (*A)[l] = (*A)[0] + (size_t) l * *n;
+      (*b)[l] = ps->b[i];
+      for (k = ps->row_start[i]; k < ps->row_start[i + 1]; k++) {
+         if (col[ps->col_index[k]] != -1) {
+            (*A)[l][col[ps->col_index[k]]] = ps->row_values[k];
+         }
+      }
+      l++;
+   }
+   for (i = 0; i < ps->n; i++) {
+      if (col[i] != -1) {
+         (*c)[col[i]] = (ps->c ? ps->c[i] : 0);
+      }
+   }
+   free(col);
+   return EXIT_SUCCESS;
+}
+
+/* Same as presolved_LP, but store the reduced LP in lp, with A
+   in compressed sparse columns. */
+int presolved_sparse_LP(const Presolve * ps, SparseLP * lp)
+{
+   int *        row = malloc((ps->m + 1) * sizeof(int));
+   unsigned int k;
+   unsigned int nnz = 0;
+   int          i;
+   int          j;
+   int          l;
+
+   memset(lp, 0, sizeof(SparseLP));
+   if (row) {
+      lp->m = reduced_indices(ps->row_alive, ps->m, row);
+      lp->n = ps->n - ps->removed_cols;
+      for (j = 0; j < ps->n; j++) {
+         if (!ps->col_alive[j]) {
+            continue;
+         }
+         for (k = ps->col_start[j]; k < ps->col_start[j + 1]; k++) {
+            nnz += (row[ps->row_index[k]] != -1);
+         }
+      }
+      lp->col_start = malloc((lp->n + 1) * sizeof(unsigned int));
+      lp->row_index = malloc((nnz + 1) * sizeof(unsigned int));
+      lp->values = malloc((nnz + 1) * sizeof(double));
+      lp->b = malloc((lp->m + 1) * sizeof(double));
+      lp->c = malloc((lp->n + 1) * sizeof(double));
+   }
+   if (!row || !lp->col_start || !lp->row_index || !lp->values ||
+       !lp->b || !lp->c) {
+      fprintf(stderr, "Memory allocation failure.\n");
+      free(row);
+      free_sparse_LP(lp);
+      return EXIT_FAILURE;
+   }
+
+   l = 0;
+   lp->col_start[0] = 0;
+   for (j = 0; j < ps->n; j++) {
+      if (!ps->col_alive[j]) {
+         continue;
+      }
+      lp->c[l] = (ps->c ? ps->c[j] : 0);
+      lp->col_start[l + 1] = lp->col_start[l];
+      for (k = ps->col_start[j]; k < ps->col_start[j + 1]; k++) {
+         if (row[ps->row_index[k]] != -1) {
+            lp->row_index[lp->col_start[l + 1]] = row[ps->row_index[k]];
+            lp->values[lp->col_start[l + 1]++] = ps->col_values[k];
+         }
+      }
+      l++;
+   }
+   lp->nnz = nnz;
+   for (i = 0; i < ps->m; i++) {
+      if (row[i] != -1) {
+         lp->b[row[i]] = ps->b[i];
+      }
+   }
+   free(row);
+   return EXIT_SUCCESS;
+}
+
+double *postsolve_solution(const Presolve * ps, const double * x)
+{
+   double *          sol = calloc(ps->n + 1, sizeof(double));
+   const Reduction * r;
+   unsigned int      p;
+   int               d;
+   int               i;
+   int               j;
+   int               k;
+   int               l;
+   double            a;
+   double            res;
+
+   l = 0;
+   for (j = 0; j < ps->n; j++) {
+      if (ps->col_alive[j]) {
+         sol[j] = x[l++];
+      }
+   }
+   for (d = ps->depth - 1; d >= 0; d--) {
+      r = &ps->stack[d];
+      if (r->type == REDUCTION_FIX) {
+         sol[r->col] = r->value;
+         continue;
+      }
+
+      /* Take the value of x_j for which the tightest of the
+         rows removed with it holds with equality. The columns
+         removed before x_j are still 0 in sol. */
+      for (k = 0; k < r->count; k++) {
+         i = r->rows[k];
+         a = 0;
+         res = r->b[k];
+         for (p = ps->row_start[i]; p < ps->row_start[i + 1]; p++) {
+            if ((int) ps->col_index[p] == r->col) {
+               a = ps->row_values[p];
+            }
+            else {
+               res -= ps->row_values[p] * sol[ps->col_index[p]];
+            }
+         }
+         if (k == 0 || (a > 0 ? res / a < sol[r->col] : res / a > sol[r->col])) {
+            sol[r->col] = res / a;
+         }
+      }
+   }
+   return sol;
+}
+
+double *postsolve_certificate(const Presolve * ps, const double * y)
+{
+   double * cert = calloc(ps->m + 1, sizeof(double));
+   int      i;
+   int      k;
+
+   k = 0;
+   for (i = 0; i < ps->m; i++) {
+      if (ps->row_alive[i]) {
+         cert[i] = y[k++];
+      }
+   }
+   undo_certificate(ps, cert);
+   return cert;
+}
+
+void print_presolve_stats(const Presolve * ps, FILE * fp)
+{
+   fprintf(fp, "Presolve: removed %d of %d rows and %d of %d columns "
+           "(%d empty, %d fixed, %d duplicate, %d tightened, "
+           "%d redundant, %d dominated)\n",
+           ps->removed_rows, ps->m, ps->removed_cols, ps->n, ps->empty,
+           ps->fixed, ps->duplicates, ps->tightened, ps->redundant,
+           ps->dominated);
+}
+
+void free_presolve(Presolve * ps)
+{
+   int d;
+
+   for (d = 0; d < ps->depth; d++) {
+      free(ps->stack[d].rows);
+      free(ps->stack[d].b);
+   }
+   free(ps->stack);
+   free(ps->col_start);
+   free(ps->row_index);
+   free(ps->col_values);
+   free(ps->row_start);
+   free(ps->col_index);
+   free(ps->row_values);
+   free(ps->b);
+   free(ps->c);
+   free(ps->row_alive);
+   free(ps->col_alive);
+   free(ps->certificate);
+   free(ps);
+}
@@ -2,14 +2,28 @@
 #include <stdlib.h>
 
 #include "LP_reader.h"
+#include "MPS_reader.h"
+#include "presolve.h"
 #include "lin_alg.h"
 #include "error.h"
 
+// Number of in-place pivots after which a tableaux is recomputed from scratch,
+// to keep rounding errors from the rank-one updates in check
+#define REFACTOR_FREQ 32
+
+// Partial pricing looks at the non-basic variables in this many segments,
+// multiple pricing keeps a list of this many candidates between pivots
+#define PARTIAL_SEGMENTS 8
+#define MULTIPLE_PRICING 8
+
+// Passes over the rows and columns of A made by scale_LP
+#define SCALE_PASSES 4
+
 // Structure for an LP
 typedef struct {
     Vector *b; 	// inequality vector
     Vector *c; 	// costs vector
-    Matrix *A; 	// inequality matrix
+    SparseMatrix *A; 	// inequality matrix, in compressed sparse columns
 
 } LP;
 
@@ -33,15 +47,31 @@ typedef struct {
 
     Vector *x; // Basic solution
 
-    int initialized; // Is this tableaux already initialized?
+    Workspace *W;    // Temporaries of set_tableaux, pivot_tableaux and the pivot rules
+    int pivots;      // Pivots performed since the last full recomputation
+
+    Vector *weights; // Reference weights of the pivot rule by real index, if any
+
+    int pricing_start;                  // Start of the next segment of r to price
+    int candidates[MULTIPLE_PRICING];   // Candidate positions in r, best first
+    int num_candidates;                 // Amount of candidates left
 } Tableaux;
 
-// Return pointer to a tableaux with underlying LP P computed for a given basis
+// Return pointer to a tableaux with underlying LP P computed for a given basis.
+// All its structures, and a workspace for the temporaries needed to pivot and
+// to recompute it, are allocated here once, so that set_tableaux and
+// pivot_tableaux do not allocate any memory.
 Tableaux *build_tableaux(LP *P, Vector *basis);
 
 // Set all values in a tableaux for a given basis, which is assumed to be feasible
+// and to have as many basic variables as the one it was built for
 void set_tableaux(Tableaux *T, Vector *basis);
 
+// Swap the alpha-th non-basic variable for the beta-th basic variable and
+// update p, Q, r, z0 and the conversion tables in place. Every REFACTOR_FREQ
+// pivots the tableaux is recomputed from scratch for the given basis instead.
+void pivot_tableaux(Tableaux *T, Vector *basis, int alpha, int beta);
+
 // Print relevant info of tableaux to stdout
 void print_tableaux(Tableaux *T);
 
@@ -52,11 +82,35 @@ void transform_LP_to_equality(LP *P);
 // Return pointer to LP read from file
 LP *get_LP(const char *filename);
 
+// Replace P (with x >= 0 and rows of the kind given, see PRESOLVE_LE) by
+// its presolved version. Return what is needed to map solutions back with
+// postsolve_solution, and store in result whether P was found infeasible.
+Presolve *presolve(LP *P, int rows, int *result);
+
+// Scale the rows and columns of A, and b and c with them, by the powers of
+// two closest to the inverse geometric mean of the smallest and largest
+// entry in them, alternating between rows and columns for SCALE_PASSES
+// passes. This keeps the entries close to 1, so ZERO_TOL means about the
+// same for all of them. Powers of two scale without rounding errors.
+// Return the column scale factors s: the solution of the original LP is
+// (s_1 x_1, ..., s_n x_n) for the solution x of the scaled LP.
+Vector *scale_LP(LP *P);
+
+// Turn the solution x of the scaled LP into that of the original one
+void unscale_solution(const Vector *col_scale, Vector *x);
+
 // Print relevant info of LP to stdout
 void print_LP(LP *P);
 
-// Free only those structures redefined in set_partition
-void partial_free_tableaux(Tableaux *T);
+// Read a basis of an LP in equality form with n variables and m rows,
+// returned as a bitmask. The file holds "n m" followed by the m indices
+// (starting at 0) of the basic variables, slack variables included. It
+// may have fewer rows than the LP if phase one removed redundant ones,
+// see remove_rows_for_basis.
+Vector *read_basis(const char *filename, unsigned int n, unsigned int m);
+
+// Write basis (a bitmask) to file in the format read by read_basis
+void write_basis(const char *filename, const Vector *basis);
 
 // Free structures
 void free_LP(LP *P);
@@ -0,0 +1,21 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "revised_simplex.h"
+
+// Solve an LP in equality form with the dual simplex method, provided an
+// initial basis that is dual feasible (no reduced cost is positive), but
+// not necessarily primal feasible. The final basis is left in basis.
+// Return 0 if system feasible and store optimal solution in ret
+// Return 1 if system infeasible
+// Return 2 if the basis is not dual feasible, without pivoting
+int dual_solve_LP_basis(LP *P, Vector *basis, Vector *ret);
+
+// Solve an LP in equality form, starting from a given basis, such as the
+// optimal basis of the LP before b was changed. A primal feasible basis is
+// handed to the revised simplex method, a dual feasible one to the dual
+// simplex method, and otherwise (or if it is no basis, see check_basis) the
+// LP is solved from scratch. After adding a row, add its slack variable to
+// the basis. The final basis is left in basis. Return values as in
+// simplex_solve_LP.
+int reoptimize_LP(LP *P, Vector *basis, int pivot_rule, Vector *ret);
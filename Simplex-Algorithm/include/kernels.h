@@ -0,0 +1,33 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+// Dense kernels on arrays of doubles, used by the routines in lin_alg.
+// Every kernel has a portable version and, on x86, AVX2 and AVX-512 versions.
+// The fastest set the CPU supports is picked at the first call. Compile with
+// -DNO_SIMD to only build the portable versions.
+
+// Kernel sets, see kernels_select
+#define KERNELS_GENERIC 0
+#define KERNELS_AVX2 1
+#define KERNELS_AVX512 2
+
+// Return a^t b
+double kernel_dot(const double *a, const double *b, int n);
+// y += l x
+void kernel_axpy(double *y, double l, const double *x, int n);
+// a += b
+void kernel_add(double *a, const double *b, int n);
+// a -= b
+void kernel_sub(double *a, const double *b, int n);
+// a *= l
+void kernel_scale(double *a, double l, int n);
+
+// C += AB for column-major A (m x k), B (k x n) and C (m x n), where the
+// columns of each start ld entries apart. Blocked for registers and cache.
+void kernel_gemm(int m, int n, int k, const double *A, int lda,
+        const double *B, int ldb, double *C, int ldc);
+
+// Use the best kernel set the CPU supports, up to the given one
+void kernels_select(int level);
+// Return the name of the kernel set in use
+const char *kernels_name(void);
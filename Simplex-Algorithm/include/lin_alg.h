@@ -1,39 +1,104 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 
 #include "error.h"
+#include "kernels.h"
 
 #define ZERO_TOL 0.001
 
-// Structure for a matrix
+// LU_decomp takes a matrix as singular if a pivot is at most this times the
+// largest entry in its column, so that badly scaled matrices are not rejected
+#define PIVOT_TOL 1e-9
+
+// Amount of columns per panel in householder_QR
+#define QR_BLOCK 32
+
+// Columns of a matrix start at multiples of this many bytes
+#define MATRIX_ALIGN 64
+
+// Structure for a matrix, stored column by column in one contiguous block
 typedef struct {
     unsigned int size_r;    // Number of rows of matrix
     unsigned int size_c;    // Number of columns of matrix
-    double **entries;       // Actual matrix entries
+    unsigned int ld;        // Leading dimension: distance between the starts of two columns
+    double *entries;        // Actual matrix entries, see ENTRY
     unsigned int rank;      // Rank of the matrix
 } Matrix;
 
+// Entry (i, j) of a matrix
+#define ENTRY(A, i, j) ((A)->entries[(size_t)(j) * (A)->ld + (i)])
+// Pointer to the (contiguous) column j of a matrix
+#define COL(A, j) ((A)->entries + (size_t)(j) * (A)->ld)
+
 // Structure for a vector
 typedef struct {
     unsigned int size;  // Number of entries
     double *entries;    // Actual vector entries
 } Vector;
 
+// Structure for a sparse matrix in compressed sparse column format:
+// the non-zero entries of column j are values[k] in rows row_index[k],
+// for col_start[j] <= k < col_start[j + 1]
+typedef struct {
+    unsigned int size_r;        // Number of rows of matrix
+    unsigned int size_c;        // Number of columns of matrix
+    unsigned int nnz;           // Number of non-zero entries
+    unsigned int *col_start;    // Start of each column in row_index and values (size_c + 1 entries)
+    unsigned int *row_index;    // Row of each non-zero entry
+    double *values;             // Value of each non-zero entry
+} SparseMatrix;
+
+// Structure for a workspace: one block of memory, allocated once, from which
+// vectors and matrices are handed out and given back in stack order. Loops
+// that need the same temporaries over and over take them from a workspace
+// instead of allocating and freeing them each time.
+typedef struct {
+    size_t size;    // Number of doubles in block
+    size_t used;    // Number of doubles handed out
+    double *block;  // Aligned to MATRIX_ALIGN, as is everything handed out
+} Workspace;
+
 // Return whether l is very close to zero (see ZERO_TOL)
 int is_zero(double l);
 
 // Compute a QR-decompostion of A and store it in Q, R. 
-// Uses classical Gram-Schmidt and only gives an orthogonal Q
-// if A is of full rank.
+// Uses householder_QR, so Q is orthogonal even if A is rank deficient.
 void QR_decomp(const Matrix *A, Matrix *Q, Matrix *R);
 
+// Compute a Householder QR-decomposition of A in place: R ends up on and
+// above the diagonal, and below the diagonal of column k the vector v_k of
+// the reflector H_k = I - tau_k v_k v_k^t (whose leading 1 is not stored).
+// Columns are factored in panels of QR_BLOCK. tau needs min(m, n) entries.
+void householder_QR(Matrix *A, Vector *tau);
+
+// Solve Ax = b in place, given QR and tau from householder_QR of a square,
+// non-singular A. Overwrites b by the solution.
+void QR_solve(const Matrix *QR, const Vector *tau, Vector *b);
+// Same as QR_solve, but for all columns of B at once, reusing the factorization
+void QR_solve_matrix(const Matrix *QR, const Vector *tau, Matrix *B);
+
 // Return a pointer to a vector of given size with zero entries
 Vector *zero_vector(int size);
 // Return a pointer to a matrix of given size with zero entries
 Matrix *zero_matrix(int size_r, int size_c);
 // Return a pointer to a copy of a vector
 Vector *copy_vector(const Vector *vector);
+
+// Return a pointer to a workspace of given size, in doubles
+Workspace *new_workspace(size_t size);
+// Return the number of doubles a workspace needs for a matrix of given size,
+// or for a vector of given size with size_c = 1
+size_t workspace_size(int size_r, int size_c);
+// Return a vector of given size with zero entries, taken from a workspace
+Vector workspace_vector(Workspace *W, int size);
+// Return a matrix of given size with zero entries, taken from a workspace
+Matrix workspace_matrix(Workspace *W, int size_r, int size_c);
+// Return the amount of a workspace in use, to be passed to workspace_release
+size_t workspace_mark(const Workspace *W);
+// Give back everything taken from a workspace since mark was returned
+void workspace_release(Workspace *W, size_t mark);
 // Copy entries of a vector into another vector
 void copy_to_vector(Vector *vector, const Vector *ret);
 
@@ -47,9 +112,13 @@ Matrix *subind_matrix(const Matrix *matrix, const Vector *bitmask);
 // Return a pointer to a submatrix of matrix consisting of the columns
 // corresponding to the entries in bitmask unequal to 0
 Vector *subind_vector(const Vector *vector, const Vector *bitmask);
+// Same as subind_vector, but store the subvector in ret
+void subind_to_vector(const Vector *vector, const Vector *bitmask, Vector *ret);
 
 // Return a pointer to a matrix equal to AB, uses a naieve algorithm
 Matrix *mult_matrix(const Matrix *A, const Matrix *B);
+// Same as mult_matrix, but store AB in res
+void mult_to_matrix(const Matrix *A, const Matrix *B, Matrix *res);
 // Return a pointer to the transpose of the given matrix
 Matrix *trans_matrix(const Matrix *matrix);
 
@@ -61,6 +130,10 @@ void scalar_to_matrix(Matrix *A, const double l);
 
 // Return a pointer to matrix * vector
 Vector *mult_vector(const Matrix *matrix, const Vector *vector);
+// Return a pointer to matrix^t * vector
+Vector *mult_vector_trans(const Matrix *matrix, const Vector *vector);
+// Same as mult_vector_trans, but store matrix^t * vector in ret
+void mult_trans_to_vector(const Matrix *matrix, const Vector *vector, Vector *ret);
 
 // Return a pointer to a vector equal to a+b
 Vector *add_vector(const Vector *a, const Vector *b);
@@ -77,6 +150,13 @@ void scalar_to_vector(Vector *a, const double l);
 void replace_col(Matrix *matrix, const Vector *vector, unsigned int col);
 // Place the entries of a column in a matrix in a vector
 void copy_col(const Matrix *matrix, Vector *vector, unsigned int col);
+// Replace the i-th row of given matrix by given vector
+void replace_row(Matrix *matrix, const Vector *vector, unsigned int row);
+// Place the entries of a row in a matrix in a vector
+void copy_row(const Matrix *matrix, Vector *vector, unsigned int row);
+// Return a vector sharing its entries with a column of the matrix.
+// It is only valid as long as the matrix is and must not be freed.
+Vector col_view(const Matrix *matrix, unsigned int col);
 
 // Set all entries in given vector to zero
 void reset_vector(const Vector *vector);
@@ -97,11 +177,66 @@ Matrix *inverse_matrix(const Matrix *A);
 Vector *solve_system(const Matrix *A, const Vector *b);
 // Return solution to QRx = b, where Q unitary, R upper triangular. 
 Vector *solve_system_QR(const Matrix *Q, const Matrix *R, const Vector *b);
+// Compute an LU-decomposition with partial pivoting of A in place, such that
+// afterwards the part of A below the diagonal holds L (which has ones on its
+// diagonal), the rest of A holds U and row i of LU is row perm[i] of A.
+void LU_decomp(Matrix *A, Vector *perm);
+// Same as LU_decomp, but return 1 instead of stopping if A is singular, else 0
+int try_LU_decomp(Matrix *A, Vector *perm);
+// Overwrite b by the solution to Ax = b, given an LU-decomposition of A
+void LU_solve(const Matrix *LU, const Vector *perm, Vector *b);
+// Same as LU_solve, but for all columns of B at once, reusing the factorization
+void LU_solve_matrix(const Matrix *LU, const Vector *perm, Matrix *B);
+// Same as LU_solve, but take its scratch space from W
+void LU_solve_workspace(const Matrix *LU, const Vector *perm, Vector *b, Workspace *W);
+// Overwrite x by the solution to Ax = b for the column col of a sparse matrix B,
+// given an LU-decomposition of A and the inverse of its permutation
+// (inv_perm[perm[i]] = i). Only the non-zero entries of b are read, and the
+// substitutions skip the zeros of the right-hand side.
+void LU_solve_sparse(const Matrix *LU, const Vector *inv_perm, const SparseMatrix *B,
+        unsigned int col, Vector *x);
+// Overwrite b by the solution to A^t x = b, given an LU-decomposition of A
+void LU_solve_trans(const Matrix *LU, const Vector *perm, Vector *b);
+
 // Return the rank of a square matrix
 int rank(const Matrix *A);
 // Return the rank of an upper triangular matrix
 int rank_R(const Matrix *R);
 
+// Return a pointer to a sparse matrix with room for nnz non-zero entries
+SparseMatrix *empty_sparse_matrix(int size_r, int size_c, int nnz);
+// Return a pointer to a sparse copy of a matrix
+SparseMatrix *sparse_from_matrix(const Matrix *matrix);
+// Return a pointer to a dense copy of a sparse matrix
+Matrix *sparse_to_matrix(const SparseMatrix *matrix);
+// Return a pointer to the sparse matrix (A | I)
+SparseMatrix *sparse_append_identity(const SparseMatrix *A);
+// Return a pointer to the sparse matrix A with the column signs_i e_i
+// appended for each i with signs_i unequal to 0, in order of i
+SparseMatrix *sparse_append_unit_columns(const SparseMatrix *A, const Vector *signs);
+// Return a pointer to a dense submatrix of matrix consisting of the
+// columns corresponding to the entries in bitmask unequal to 0
+Matrix *sparse_subind_matrix(const SparseMatrix *matrix, const Vector *bitmask);
+// Same as sparse_subind_matrix, but store the submatrix in ret
+void sparse_subind_to_matrix(const SparseMatrix *matrix, const Vector *bitmask, Matrix *ret);
+// Place the entries of a column in a sparse matrix in a (dense) vector
+void sparse_copy_col(const SparseMatrix *matrix, Vector *vector, unsigned int col);
+// Return the inner product of a column of a sparse matrix and a vector
+double sparse_col_product(const SparseMatrix *matrix, unsigned int col, const Vector *vector);
+// Return a pointer to matrix * vector
+Vector *sparse_mult_vector(const SparseMatrix *matrix, const Vector *vector);
+// Multiply the i-th row of a sparse matrix by l[i], for all rows
+void sparse_scale_rows(SparseMatrix *matrix, const Vector *l);
+// Multiply the j-th column of a sparse matrix by l[j], for all columns
+void sparse_scale_columns(SparseMatrix *matrix, const Vector *l);
+// Keep only the rows of a sparse matrix corresponding to the entries in
+// bitmask unequal to 0, in place
+void sparse_subind_rows(SparseMatrix *matrix, const Vector *bitmask);
+// Print a sparse matrix to stdout
+void print_sparse_matrix(const SparseMatrix *matrix);
+
 // Free structures
 void free_vector(Vector *vector);
 void free_matrix(Matrix *matrix);
+void free_sparse_matrix(SparseMatrix *matrix);
+void free_workspace(Workspace *W);
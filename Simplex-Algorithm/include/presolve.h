@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/* SparseLP is declared in MPS_reader.h, which has to be
+ * included first. */
+
+/* Results of presolve_LP. */
+#define PRESOLVE_OK         0
+#define PRESOLVE_INFEASIBLE 1
+
+/* Kinds of LPs presolve_LP handles: the rows are Ax <= b or
+ * Ax = b, the variables x >= 0 or free. */
+#define PRESOLVE_LE     0
+#define PRESOLVE_EQ     1
+#define PRESOLVE_NONNEG 0
+#define PRESOLVE_FREE   1
+
+/* Values within this of each other count as equal. */
+#define PRESOLVE_TOL 1e-9
+
+/* One reduction, undone by postsolve_solution and
+ * postsolve_certificate in reverse order. */
+typedef struct {
+	int      type;     /* See the reductions in presolve.c */
+	int      col;      /* Column removed */
+	double   value;    /* Value it was fixed to */
+	int      lower;    /* Rows giving the bounds it was fixed */
+	int      upper;    /* with, or -1 */
+	int      count;    /* Rows removed with the column: */
+	int *    rows;     /* their indices, and their */
+	double * b;        /* right-hand sides at the time */
+} Reduction;
+
+/* An LP being presolved. A, b and c are a working copy of the
+ * original LP, which shrinks as rows and columns are removed.
+ * A is kept both in compressed sparse columns, as in SparseLP,
+ * and in compressed sparse rows, sorted either way. Only b
+ * changes: rows and columns are removed by marking them. */
+typedef struct {
+	int            m;             /* Size of the original LP */
+	int            n;
+	int            rows;          /* Equality or inequality rows */
+	int            vars;          /* Free or non-negative variables */
+	unsigned int * col_start;
+	unsigned int * row_index;
+	double *       col_values;
+	unsigned int * row_start;
+	unsigned int * col_index;
+	double *       row_values;
+	double *       b;
+	double *       c;
+	char *         row_alive;
+	char *         col_alive;
+	Reduction *    stack;
+	int            depth;
+	int            capacity;
+
+	/* A certificate of infeasibility (one weight for each
+	 * original row) if presolve_LP found one, else NULL */
+	double *       certificate;
+
+	/* Statistics */
+	int            removed_rows;
+	int            removed_cols;
+	int            empty;         /* Empty rows and columns */
+	int            fixed;         /* Fixed variables */
+	int            duplicates;    /* Rows parallel to a tighter one */
+	int            tightened;     /* Bounds replaced by a tighter one */
+	int            redundant;     /* Rows implied by the bounds */
+	int            dominated;     /* Columns left at a bound, or solved
+	                               * for last with all their rows */
+} Presolve;
+
+Presolve *presolve_LP(int, int, double**, double*, double*,
+			int, int, int*);
+Presolve *presolve_sparse_LP(const SparseLP*, int, int, int*);
+int presolved_LP(const Presolve*, int*, int*,
+			double***, double**, double**);
+int presolved_sparse_LP(const Presolve*, SparseLP*);
+double *postsolve_solution(const Presolve*, const double*);
+double *postsolve_certificate(const Presolve*, const double*);
+void print_presolve_stats(const Presolve*, FILE*);
+void free_presolve(Presolve*);
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "simplex_algorithm.h"
+
+// Structure for a basis in the revised simplex method. Instead of a full
+// tableaux, only an LU-decomposition of A_B at the last refactorization is
+// kept, together with an eta file describing the pivots done since.
+typedef struct {
+    LP *P;      // Underlying LP
+
+    Vector *B;          // bitmask indicating which variables are in basis (1 = in basis)
+    Vector *indices_B;  // Conversion table to real indices
+    Vector *x_B;        // Values of the basic variables
+
+    Matrix *LU;     // LU-decomposition of A_B at the last refactorization
+    Vector *perm;   // Row permutation belonging to LU
+
+    Vector *eta[REFACTOR_FREQ];     // Entering columns (A_B)^-1 a_alpha of the pivots since
+    int eta_row[REFACTOR_FREQ];     // Basis positions at which they entered
+    int num_eta;                    // Amount of pivots since the last refactorization
+
+    int size_B;     // Amount of basic variables
+    int size;       // Amount of variables
+
+    Vector *weights;    // Reference weights of the pivot rule, if any
+
+    int dual;   // May the basic solution be infeasible, as in the dual simplex?
+
+    int pricing_start;                  // First variable of the next segment to price
+    int candidates[MULTIPLE_PRICING];   // Candidate variables, best first
+    int num_candidates;                 // Amount of candidates left
+} RevisedBasis;
+
+// Return pointer to a factorized basis of P for a given (feasible) basis
+RevisedBasis *build_revised_basis(LP *P, Vector *basis);
+
+// Same as build_revised_basis, but the basis only needs to be dual feasible
+RevisedBasis *build_dual_basis(LP *P, Vector *basis);
+
+// Recompute the LU-decomposition of A_B and the basic solution from scratch
+void refactor_revised_basis(RevisedBasis *R);
+
+// Overwrite v by (A_B)^-1 v
+void ftran(const RevisedBasis *R, Vector *v);
+// Overwrite v by ((A_B)^t)^-1 v
+void btran(const RevisedBasis *R, Vector *v);
+
+// Replace the basic variable at position beta by variable alpha (a real
+// index), where u = (A_B)^-1 a_alpha. The eta file takes ownership of u.
+void pivot_revised_basis(RevisedBasis *R, int alpha, int beta, Vector *u);
+
+// Store the dual values y = ((A_B)^t)^-1 c_B
+void dual_values(const RevisedBasis *R, Vector *y);
+// Return the reduced cost c_j - (a_j)^t y of variable j, or zero if it is basic
+double reduced_cost(const RevisedBasis *R, const Vector *y, int j);
+// Return pointer to (A_B)^-1 a_alpha
+Vector *entering_column(const RevisedBasis *R, int alpha);
+
+// Solve an LP in equality form with the revised simplex method, provided an
+// initial feasible basis. The final basis is left in basis.
+// Return 0 if system feasible and bounded and store optimal solution in ret
+// Return 1 if system unbounded
+int revised_solve_LP_basis(LP *P, Vector *basis, int pivot_rule, Vector *ret);
+
+// Solve an LP using the revised simplex method, return values as in simplex_solve_LP.
+// Phase one removes redundant equality constraints from P, see remove_redundant_rows
+int revised_solve_LP(LP *P, int pivot_rule, Vector *ret);
+// Same as revised_solve_LP, but also store the final basis in final_basis
+int revised_solve_LP_final_basis(LP *P, int pivot_rule, Vector *final_basis, Vector *ret);
+
+// Free structures
+void free_revised_basis(RevisedBasis *R);
@@ -10,8 +10,57 @@
 #define UNBOUNDED   2
 #define WRONG_FORM  3
 
+// Results of check_basis
+#define BASIS_INVALID       0   // Not m variables, or A_B singular
+#define BASIS_INFEASIBLE    1   // Basic solution has negative entries
+#define BASIS_FEASIBLE      2
+
 #define BLAND 0
 #define LCR 1
+#define STEEPEST_EDGE 2
+#define DEVEX 3
+#define PARTIAL 4
+#define MULTIPLE 5
+
+// Devex weights are reset to one once one of them grows beyond this
+#define DEVEX_RESET 1e6
+
+#define TABLEAUX 0  // simplex_solve_LP
+#define REVISED 1   // revised_solve_LP
+#define DUAL 2      // reoptimize_LP, from the slack basis if there is one
+
+#define RATIO_STANDARD 0    // Minimum ratio test
+#define RATIO_HARRIS 1      // Harris' two-pass ratio test
+
+// Default amount by which Harris' ratio test may let basic values become
+// negative. It has to stay below ZERO_TOL, see fill_basic_solution.
+#define HARRIS_TOL 1e-7
+// Consecutive degenerate pivots after which the simplex counts as stalling
+#define STALL_LIMIT 10
+// Size of the perturbation of degenerate basic values, see perturb_basic_solution
+#define PERTURBATION 1e-6
+// Smallest pivot of a column in the crash basis relative to its largest entry
+#define CRASH_TOL 0.1
+
+// Parameters of simplex_solve_LP and revised_solve_LP
+typedef struct {
+    int ratio_test;         // Ratio test used to choose beta, see RATIO_STANDARD
+    double harris_tol;      // Tolerance of Harris' ratio test
+    int perturb;            // Perturb the basic solution when stalling? Harris'
+                            // test alone can cycle on degenerate LPs
+} SimplexParams;
+
+// Counters of the last call to simplex_solve_LP or revised_solve_LP
+typedef struct {
+    int pivots;             // Pivots done in total
+    int phase_one_pivots;   // Pivots done to find an initial feasible basis
+    int degenerate_pivots;  // Pivots that left the basic solution as it was
+    int avoided_degenerate; // Pivots where Harris' test moved, but the minimum ratio test would not have
+    int perturbations;      // Times the basic solution was perturbed
+} SimplexStats;
+
+extern SimplexParams simplex_params;
+extern SimplexStats simplex_stats;
 
 // Solve an LP using the simplex algorithm, provided an initial feasible basis.
 // Return 0 if system feasible and bounded and store optimal solution in ret
@@ -24,18 +73,89 @@ int choose_alpha(Tableaux *T, int pivot_rule);
 int choose_alpha_BLAND(Tableaux *T);
 // Largest Coeffient Rule
 int choose_alpha_LCR(Tableaux *T);
+// Steepest-edge and Devex rules: largest r_j^2 / w_j, where w_j is the
+// reference weight of the j-th non-basic variable
+int choose_alpha_weighted(Tableaux *T);
+
+// Partial pricing: largest coefficient in the next segment of r (see
+// PARTIAL_SEGMENTS) that has a positive one, going round from the last
+int choose_alpha_PARTIAL(Tableaux *T);
+// Multiple pricing: largest coefficient among the candidates of the last
+// full pricing that are still attractive, or a new full pricing if none is
+int choose_alpha_MULTIPLE(Tableaux *T);
+// Insert index with a value into a list of at most MULTIPLE_PRICING
+// candidates sorted by decreasing value, dropping the last one if full
+void insert_candidate(int *candidates, double *values, int *num, int index, double value);
 
-// Choose beta as in lecture notes. If no valid beta exists,
-// return -1, indicating the LP is unbounded
+// Set the reference weights of the pivot rule for the current basis. For
+// steepest-edge these are w_j = 1 + |Q_j|^2, for Devex they start at one.
+void init_weights(Tableaux *T, int pivot_rule);
+// Update the reference weights for swapping alpha for beta, before pivoting
+void update_weights(Tableaux *T, int pivot_rule, int alpha, int beta);
+
+// Choose beta as in lecture notes, using the ratio test of simplex_params.
+// If no valid beta exists, return -1, indicating the LP is unbounded
 int choose_beta(Tableaux *T, int alpha);
 
+// Choose the basic variable that leaves when the basic solution x moves to
+// x - tu for growing t >= 0, using the ratio test of simplex_params. Only
+// entries of u above PIVOT_TOL times the largest |u_i| block, and negative
+// x_i count as zero. With RATIO_STANDARD this is the one with the minimum
+// ratio x_i / u_i. Harris' test first finds the largest step
+// t_max for which no x_i drops below -harris_tol, then takes the largest u_i
+// with x_i / u_i <= t_max; values up to harris_tol count as zero for it.
+// Ties are broken on the real indices of the variables. Return -1 if
+// nothing blocks, that is if the LP is unbounded.
+int ratio_test(const Vector *x, const Vector *u, const Vector *indices_B);
+
+// Count a pivot in simplex_stats. A pivot is degenerate if the leaving
+// variable is at most harris_tol. stalled holds the amount of consecutive
+// degenerate pivots, which only add up if perturb is set.
+void count_pivot(int degenerate, int *stalled);
+
+// Raise the basic values x_i <= harris_tol of P by between PERTURBATION and
+// twice that, differently for each i, and count this in simplex_stats. This
+// moves the basic solution away from a degenerate vertex the pivot rule
+// stalls on. b is changed to match, so that the perturbation survives
+// recomputing the basic solution; the caller restores it at the end, and
+// finishes with the dual simplex if the final basis is then infeasible.
+void perturb_basic_solution(LP *P, Vector *x, const Vector *indices_B);
+
 // Swap alpha for beta in B using the index conversion tables
 void swap_basis(Vector* B, const Tableaux *T, int alpha, int beta);
 
-// Return a pointer to the LP used to find an initial basis for the LP
-LP *initial_basis_LP(LP *P);
+// Find a crash basis: a set of columns of A which is triangular up to
+// permutation and has a nonnegative basic solution, taking singleton
+// columns such as slack variables first. Store it in basis (a bitmask)
+// and set signs_i to 0 for the rows it covers. The remaining rows get
+// signs_i = 1 or -1, the sign of the artificial variable for them.
+// Return the number of remaining rows.
+int crash_basis(LP *P, Vector *basis, Vector *signs);
+
+// Return a pointer to the LP used to find an initial basis for the LP,
+// which has artificial variables only for the rows not covered by
+// crash_basis. Its initial basis is stored in a new vector *basis. If
+// there are no artificial variables, this is a feasible basis for the LP.
+LP *initial_basis_LP(LP *P, Vector **basis);
 
-// Find an initial basis for an LP using the method from the lecture notes
+// Remove the rows of P whose artificial variable is still basic in the
+// basis of I after phase one, once the others are driven out. The row of
+// the tableau of such a variable is zero on the variables of P, so its
+// row of A is a combination of the other rows, and phase one has found
+// b to match. The rest of basis is then a basis for P. Return the number
+// of rows removed.
+int remove_redundant_rows(LP *P, const LP *I, const Vector *basis);
+
+// Remove rows of P so that basis fits it, if it has fewer than m variables
+// as a basis written after remove_redundant_rows has. The rows A_B does not
+// cover get artificial variables, and those left basic once the others are
+// driven out are removed as by remove_redundant_rows. Nothing is removed if
+// A_B has dependent columns or the rows are inconsistent. Return the
+// number of rows removed.
+int remove_rows_for_basis(LP *P, const Vector *basis);
+
+// Find an initial basis for an LP using the method from the lecture notes.
+// Redundant equality constraints are removed from P, see remove_redundant_rows
 // Return 0 if system feasible and store the basis in ret
 // Return 1 if no basis can be found
 int find_initial_basis(LP *P, int pivot_rule, Vector* ret);
@@ -46,3 +166,16 @@ int find_initial_basis(LP *P, int pivot_rule, Vector* ret);
 // Return 2 if system unbounded
 // Return 3 if system cannot be solved (m > n)
 int simplex_solve_LP(LP *P, int pivot_rule, Vector *ret);
+// Same as simplex_solve_LP, but also store the final basis in final_basis
+int simplex_solve_LP_final_basis(LP *P, int pivot_rule, Vector *final_basis, Vector *ret);
+
+// Return whether basis (a bitmask) is a basis of P and if its basic
+// solution is feasible, see BASIS_INVALID. Basic values below -harris_tol
+// make it infeasible, as in the ratio test and the dual simplex.
+int check_basis(LP *P, const Vector *basis);
+
+// Solve an LP starting from a given basis, such as the final basis of a
+// similar LP. Phase one is skipped if the basis is feasible, otherwise the
+// LP is solved as by simplex_solve_LP. The final basis is left in basis.
+// Return values as in simplex_solve_LP.
+int simplex_solve_LP_warm(LP *P, Vector *basis, int pivot_rule, Vector *ret);
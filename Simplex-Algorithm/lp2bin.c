@@ -0,0 +1,24 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "LP_reader.h"
+
+// Convert an LP file to the binary format, which both bin/main and
+// FM read without parsing: see write_LP_binary
+int main(int argc, const char *argv[]){
+    int m, n;
+    double **A, *b, *c;
+
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <lp file> <binary lp file>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (read_LP(argv[1], &m, &n, &A, &b, &c) != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    if (write_LP_binary(argv[2], m, n, A, b, c) != EXIT_SUCCESS) {
+        release_memory(A, b, c);
+        return EXIT_FAILURE;
+    }
+    release_memory(A, b, c);
+    return EXIT_SUCCESS;
+}
@@ -1,7 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-#include "simplex_algorithm.h"
+#include "dual_simplex.h"
 
 #define EQUALITY_FORM   1
 #define INEQUALITY_FORM 0
@@ -12,44 +13,136 @@ int main(int argc, const char *argv[]){
 
     int form = INEQUALITY_FORM;
     int pivot_rule = LCR;
-    if (argc < 2 || argc > 5) {
-        fprintf(stderr, "Usage: %s <lp file> <form> <pivot_rule> \n", argv[0]);
-        return EXIT_SUCCESS;
-    }
-    if (argc == 2) {
-        P = get_LP(argv[1]);
+    int engine = TABLEAUX;
+
+    // Take out the options -b <basis file> and -w <basis file>, which
+    // give a starting basis and a file to write the final basis to, -P,
+    // which presolves the LP, -S, which scales it, and -v, which prints
+    // the pivot counts of simplex_stats
+    const char *basis_in = NULL, *basis_out = NULL;
+    const char *args[argc];
+    int i, num_args = 0, use_presolve = 0, use_scaling = 0, verbose = 0;
+    for (i = 0; i < argc; i++) {
+        if ((strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "-w") == 0) && i + 1 < argc) {
+            if (argv[i][1] == 'b')
+                basis_in = argv[++i];
+            else
+                basis_out = argv[++i];
+        }
+        else if (strcmp(argv[i], "-P") == 0)
+            use_presolve = 1;
+        else if (strcmp(argv[i], "-S") == 0)
+            use_scaling = 1;
+        else if (strcmp(argv[i], "-v") == 0)
+            verbose = 1;
+        else
+            args[num_args++] = argv[i];
     }
-    if (argc == 3) {
-        P = get_LP(argv[1]);
-        form = atoi(argv[2]);
+    if (num_args == 8)
+        simplex_params.harris_tol = atof(args[7]);
+    // The tolerance has to stay below ZERO_TOL, see HARRIS_TOL
+    if (num_args < 2 || num_args > 8 ||
+            !(simplex_params.harris_tol >= 0 && simplex_params.harris_tol < ZERO_TOL)) {
+        fprintf(stderr, "Usage: %s [-b <basis file>] [-w <basis file>] [-P] [-S] [-v] <lp file> <form> <pivot_rule> <engine> <ratio_test> <perturb> <tolerance>\n", argv[0]);
+        return EXIT_SUCCESS;
     }
-    if (argc == 4) {
-        P = get_LP(argv[1]);
-        form = atoi(argv[2]);   
-        pivot_rule = atoi(argv[3]);
+    P = get_LP(args[1]);
+    if (num_args >= 3)
+        form = atoi(args[2]);
+    if (num_args >= 4)
+        pivot_rule = atoi(args[3]);
+    if (num_args >= 5)
+        engine = atoi(args[4]);
+    if (num_args >= 6)
+        simplex_params.ratio_test = atoi(args[5]);
+    if (num_args >= 7)
+        simplex_params.perturb = atoi(args[6]);
+
+    // Presolve the LP, which may show it is infeasible right away, or
+    // leave no rows, so that only c decides. The indices in basis files
+    // refer to the reduced LP then.
+    Presolve *ps = NULL;
+    int result = -1;
+    if (use_presolve) {
+        int presolve_result;
+        ps = presolve(P, form == EQUALITY_FORM ? PRESOLVE_EQ : PRESOLVE_LE,
+                      &presolve_result);
+        print_presolve_stats(ps, stderr);
+        if (presolve_result == PRESOLVE_INFEASIBLE)
+            result = INFEASIBLE;
+        else if (P->A->size_r == 0)
+            result = (is_smaller_zero_vect(P->c) ? SOLVABLE : UNBOUNDED);
     }
 
+    Vector *col_scale = NULL;
+    if (use_scaling && result == -1)
+        col_scale = scale_LP(P);
+
     // If LP was given in inequality form, add slack variables
-    int orig_size;
-    if (form == INEQUALITY_FORM) {
-        orig_size = P->A->size_c;
+    int orig_size = P->A->size_c;
+    if (form == INEQUALITY_FORM)
         transform_LP_to_equality(P);
-    }
 
-    // Solve the LP using the simplex algorithm
+    // Solve the LP using the chosen variant of the simplex algorithm,
+    // starting from the basis given if any
     Vector *sol = zero_vector(P->A->size_c);
-    int result = simplex_solve_LP(P, pivot_rule, sol);
+    if (result == -1) {
+        Vector *basis;
+        if (basis_in != NULL)
+            basis = read_basis(basis_in, P->A->size_c, P->A->size_r);
+        else
+            basis = zero_vector(P->A->size_c);
+        if (engine == DUAL && form == INEQUALITY_FORM && basis_in == NULL) {
+            // The slack variables form a basis, which is dual feasible if c <= 0
+            for (i = orig_size; i < basis->size; i++)
+                basis->entries[i] = 1;
+            result = reoptimize_LP(P, basis, pivot_rule, sol);
+        }
+        else if (engine == REVISED || engine == DUAL) {
+            if (basis_in != NULL)
+                result = reoptimize_LP(P, basis, pivot_rule, sol);
+            else
+                result = revised_solve_LP_final_basis(P, pivot_rule, basis, sol);
+        }
+        else {
+            if (basis_in != NULL)
+                result = simplex_solve_LP_warm(P, basis, pivot_rule, sol);
+            else
+                result = simplex_solve_LP_final_basis(P, pivot_rule, basis, sol);
+        }
+        if (basis_out != NULL && (result == SOLVABLE || result == UNBOUNDED))
+            write_basis(basis_out, basis);
+        free_vector(basis);
+    }
 
     // Don't display the slack variables added:
     if (form == INEQUALITY_FORM) {
         Vector *temp = sol;
         sol = zero_vector(orig_size);
-        unsigned int i;
         for (i = 0; i < orig_size; i++)
             sol->entries[i] = temp->entries[i];
         free_vector(temp);
     }
 
+    if (col_scale != NULL) {
+        unscale_solution(col_scale, sol);
+        free_vector(col_scale);
+    }
+
+    // Map the solution back to the LP before presolving
+    if (ps != NULL) {
+        if (result == SOLVABLE) {
+            Vector *temp = sol;
+            sol = zero_vector(ps->n);
+            double *orig_sol = postsolve_solution(ps, temp->entries);
+            for (i = 0; i < ps->n; i++)
+                sol->entries[i] = orig_sol[i];
+            free(orig_sol);
+            free_vector(temp);
+        }
+        free_presolve(ps);
+    }
+
     // Display result
     switch (result) {
         case 0:
@@ -65,6 +158,11 @@ int main(int argc, const char *argv[]){
             printf("LP is of wrong form (m > n).\nMaybe use inequalities?\n");
             break;
     }
+    if (verbose && result != WRONG_FORM)
+        fprintf(stderr, "Pivots: %d (phase one: %d, degenerate: %d, avoided: %d, perturbations: %d)\n",
+                simplex_stats.pivots, simplex_stats.phase_one_pivots,
+                simplex_stats.degenerate_pivots, simplex_stats.avoided_degenerate,
+                simplex_stats.perturbations);
 
     free_LP(P);
     free_vector(sol);
@@ -1,93 +1,282 @@
 #include "LP.h"
 
+// Helper function for build_tableaux - not exported
+// Allocate the structures of a tableaux for a basis of the same size as the given
+// one, and a workspace for the largest set of temporaries needed at any one time:
+// those of set_p_and_Q (LU, its permutation and inverse, and LU_solve's scratch
+// vector) or those of set_r (c_B and c_N). The pivots need less.
+void alloc_tableaux(Tableaux *T, const Vector *basis) {
+    unsigned int i, m = 0;
+    for (i = 0; i < basis->size; i++)
+        m += (basis->entries[i] != 0);
+    T->size = basis->size;
+    T->size_B = m;
+    T->size_N = T->size - m;
+
+    T->B = zero_vector(T->size);
+    T->N = zero_vector(T->size);
+    T->p = zero_vector(T->size_B);
+    T->r = zero_vector(T->size_N);
+    T->Q = zero_matrix(T->size_B, T->size_N);
+    T->indices_B = zero_vector(T->size_B);
+    T->indices_N = zero_vector(T->size_N);
+    T->x = zero_vector(T->size);
+    size_t p_and_Q = workspace_size(m, m) + 3 * workspace_size(m, 1);
+    size_t r = workspace_size(m, 1) + workspace_size(T->size_N, 1);
+    T->W = new_workspace(p_and_Q > r ? p_and_Q : r);
+}
+
 Tableaux *build_tableaux(LP *P, Vector *basis) {
     Tableaux *ret = calloc(1, sizeof(Tableaux));
     ret->P = P;
+    alloc_tableaux(ret, basis);
     set_tableaux(ret, basis);
-    ret->initialized = 1;
     return ret;
 }
 
 LP *empty_LP() {
     LP *P = calloc(1, sizeof(LP));
-    P->A = calloc(1, sizeof(Matrix));
     P->b = calloc(1, sizeof(Vector));
     P->c = calloc(1, sizeof(Vector));
     return P;
 }
 
-// Negate a row in an LP - not exported
-void negate_row_LP(LP *P, int row) {
-    if (row > P->A->size_r)
-        runtime_error("negate_row_LP: row number too large");
+// Negate the rows in an LP where b < 0 - not exported
+void negate_rows_LP(LP *P) {
+    Vector *signs = zero_vector(P->b->size);
     unsigned int i;
-    for (i = 0; i < P->A->size_c; i++)
-        P->A->entries[row][i] *= -1;
-    P->b->entries[row] *= -1;
+    for (i = 0; i < P->b->size; i++) {
+        signs->entries[i] = (P->b->entries[i] < 0 ? -1 : 1);
+        P->b->entries[i] *= signs->entries[i];
+    }
+    sparse_scale_rows(P->A, signs);
+    free_vector(signs);
 }
 
 void transform_LP_to_equality(LP *P) {
     // Set a new A equal to (A | Im)
-    Matrix *new_A = zero_matrix(P->A->size_r, P->A->size_c + P->A->size_r);
-    // Copy entries
-    unsigned int i, j;
-    for (i = 0; i < P->A->size_r; i++) {
-        for (j = 0; j < P->A->size_c; j++) {
-            new_A->entries[i][j] = P->A->entries[i][j];
-        }
-    }
-    // Add identity entries
-    for (i = 0; i < P->A->size_r; i++)
-        new_A->entries[i][P->A->size_c + i] = 1;
+    SparseMatrix *new_A = sparse_append_identity(P->A);
+    unsigned int i;
 
     // Set a new c equal to (c 0)
     Vector *new_c = zero_vector(P->c->size + P->A->size_r);
     for (i = 0; i < P->c->size; i++)
         new_c->entries[i] = P->c->entries[i];
 
-    free_matrix(P->A);
+    free_sparse_matrix(P->A);
     free_vector(P->c);
     P->A = new_A;
     P->c = new_c;
 
     // Negate rows where b < 0
-    for (i = 0; i < P->A->size_r; i++) {
-        if (P->b->entries[i] < 0)
-            negate_row_LP(P, i);
+    negate_rows_LP(P);
+}
+
+// Helper function for get_LP - not exported
+// Take A, b and c from a binary LP file with A stored sparse. The
+// mapped blocks are copied as they are, without converting anything.
+LP *get_LP_binary(const LPBinary *bin) {
+    LP *P = empty_LP();
+    P->A = empty_sparse_matrix(bin->m, bin->n, bin->nnz);
+    memcpy(P->A->col_start, bin->col_start, (bin->n + 1) * sizeof(unsigned int));
+    memcpy(P->A->row_index, bin->row_index, bin->nnz * sizeof(unsigned int));
+    memcpy(P->A->values, bin->values, bin->nnz * sizeof(double));
+    P->b->size = bin->m;
+    P->b->entries = malloc((bin->m + 1) * sizeof(double));
+    memcpy(P->b->entries, bin->b, bin->m * sizeof(double));
+    P->c->size = bin->n;
+    P->c->entries = malloc((bin->n + 1) * sizeof(double));
+    memcpy(P->c->entries, bin->c, bin->n * sizeof(double));
+    return P;
+}
+
+// Helper function for get_LP_MPS and presolve - not exported
+// Let P take over the arrays of lp, which has A in compressed sparse
+// columns already, so nothing needs to be copied
+void set_sparse_LP(LP *P, const SparseLP *lp) {
+    P->A = calloc(1, sizeof(SparseMatrix));
+    P->A->size_r = lp->m;
+    P->A->size_c = lp->n;
+    P->A->nnz = lp->nnz;
+    P->A->col_start = lp->col_start;
+    P->A->row_index = lp->row_index;
+    P->A->values = lp->values;
+    P->b->size = lp->m;
+    P->b->entries = lp->b;
+    P->c->size = lp->n;
+    P->c->entries = lp->c;
+}
+
+// Helper function for get_LP - not exported
+// Take A, b and c from an MPS file, which is read into compressed
+// sparse columns to begin with
+LP *get_LP_MPS(const char *filename) {
+    SparseLP lp;
+    if (read_MPS(filename, 0, &lp) != EXIT_SUCCESS)
+        runtime_error("get_LP: could not read LP");
+    LP *P = empty_LP();
+    set_sparse_LP(P, &lp);
+    return P;
+}
+
+// Helper function for get_LP - not exported
+// Store the dense matrix A, as read by read_LP, in P as compressed sparse
+// columns and free it
+void set_dense_A(LP *P, int m, int n, double **A) {
+    // Count the non-zero entries in each column of A
+    unsigned int i, j, nnz;
+    unsigned int *next = calloc(n + 1, sizeof(unsigned int));
+    for (i = 0; i < m; i++) {
+        for (j = 0; j < n; j++)
+            next[j + 1] += (A[i][j] != 0);
+    }
+    for (j = 0; j < n; j++)
+        next[j + 1] += next[j];
+    nnz = next[n];
+
+    // Copy the entries into compressed sparse columns
+    P->A = empty_sparse_matrix(m, n, nnz);
+    memcpy(P->A->col_start, next, (n + 1) * sizeof(unsigned int));
+    for (i = 0; i < m; i++) {
+        for (j = 0; j < n; j++) {
+            if (A[i][j] != 0) {
+                P->A->row_index[next[j]] = i;
+                P->A->values[next[j]] = A[i][j];
+                next[j]++;
+            }
+        }
     }
+    release_memory(A, NULL, NULL);
+    free(next);
 }
 
 LP *get_LP(const char *filename) {
+    if (is_MPS(filename))
+        return get_LP_MPS(filename);
+
+    // Binary files with a sparse A are read directly, others by read_LP
+    LPBinary bin;
+    if (is_LP_binary(filename)) {
+        if (map_LP_binary(filename, &bin) != EXIT_SUCCESS)
+            runtime_error("get_LP: could not read LP");
+        if (bin.sparse) {
+            LP *P = get_LP_binary(&bin);
+            unmap_LP_binary(&bin);
+            return P;
+        }
+        unmap_LP_binary(&bin);
+    }
+
 	LP *P = empty_LP();
     int n,m;
-	read_LP(filename, &m, &n,
-            &P->A->entries, 
+    double **A;
+	if (read_LP(filename, &m, &n,
+            &A, 
             &P->b->entries, 
-            &P->c->entries);
-    P->A->size_r = m;
-    P->A->size_c = n;
+            &P->c->entries) != EXIT_SUCCESS)
+        runtime_error("get_LP: could not read LP");
+
+    set_dense_A(P, m, n, A);
     P->b->size = m;
     P->c->size = n;
 
 	return P;
 }
 
-// Helper function for set_tableaux - not exported
-void set_basic_solution(Tableaux *T) {
+// Helper function for scale_LP - not exported
+// Set l_i to the power of two closest to 1 / sqrt(min * max) over the
+// entries in row i (if rows) or column i of A, or to 1 if there are none
+void geometric_scale_factors(const SparseMatrix *A, int rows, Vector *l) {
+    Vector *min = zero_vector(l->size);
+    Vector *max = zero_vector(l->size);
+    unsigned int i, j, k;
+    for (i = 0; i < l->size; i++)
+        min->entries[i] = INFINITY;
+    for (j = 0; j < A->size_c; j++) {
+        for (k = A->col_start[j]; k < A->col_start[j + 1]; k++) {
+            double a = fabs(A->values[k]);
+            i = (rows ? A->row_index[k] : j);
+            if (a == 0)
+                continue;
+            min->entries[i] = fmin(min->entries[i], a);
+            max->entries[i] = fmax(max->entries[i], a);
+        }
+    }
+    for (i = 0; i < l->size; i++) {
+        if (max->entries[i] == 0)
+            l->entries[i] = 1;
+        else
+            l->entries[i] = exp2(round(-0.5 * log2(min->entries[i] * max->entries[i])));
+    }
+    free_vector(min);
+    free_vector(max);
+}
+
+Vector *scale_LP(LP *P) {
+    Vector *row = zero_vector(P->A->size_r);
+    Vector *col = zero_vector(P->A->size_c);
+    Vector *col_scale = zero_vector(P->A->size_c);
+    unsigned int i, pass;
+    for (i = 0; i < col_scale->size; i++)
+        col_scale->entries[i] = 1;
+
+    for (pass = 0; pass < SCALE_PASSES; pass++) {
+        geometric_scale_factors(P->A, 1, row);
+        sparse_scale_rows(P->A, row);
+        for (i = 0; i < row->size; i++)
+            P->b->entries[i] *= row->entries[i];
+
+        geometric_scale_factors(P->A, 0, col);
+        sparse_scale_columns(P->A, col);
+        for (i = 0; i < col->size; i++) {
+            P->c->entries[i] *= col->entries[i];
+            col_scale->entries[i] *= col->entries[i];
+        }
+    }
+    free_vector(row);
+    free_vector(col);
+    return col_scale;
+}
+
+void unscale_solution(const Vector *col_scale, Vector *x) {
+    unsigned int j;
+    for (j = 0; j < col_scale->size; j++)
+        x->entries[j] *= col_scale->entries[j];
+}
+
+Presolve *presolve(LP *P, int rows, int *result) {
+    // Hand the columns of P to presolve_sparse_LP as they are
+    SparseLP lp = {P->A->size_r, P->A->size_c, P->A->nnz, P->A->col_start,
+                   P->A->row_index, P->A->values, P->b->entries, P->c->entries};
+    Presolve *ps = presolve_sparse_LP(&lp, rows, PRESOLVE_NONNEG, result);
+
+    // Replace P by the reduced LP
+    if (presolved_sparse_LP(ps, &lp) != EXIT_SUCCESS)
+        runtime_error("presolve: could not copy LP");
+    free_sparse_matrix(P->A);
+    free(P->b->entries);
+    free(P->c->entries);
+    set_sparse_LP(P, &lp);
+    return ps;
+}
+
+// Helper function for set_tableaux and pivot_tableaux - not exported
+void fill_basic_solution(Tableaux *T) {
     int i, real_index;
-    T->x = zero_vector(T->size);
+    reset_vector(T->x);
     for (i = 0; i < T->size_B; i++) {
         real_index = (int) T->indices_B->entries[i];
-        T->x->entries[real_index] = T->p->entries[i];
-        if (T->x->entries[real_index] < -ZERO_TOL)
+        if (T->p->entries[i] < -ZERO_TOL)
             runtime_error("set_basic_solution: negative entry in basic solution");
+        // Rounding and Harris' ratio test leave values slightly below zero
+        if (T->p->entries[i] < 0)
+            T->p->entries[i] = 0;
+        T->x->entries[real_index] = T->p->entries[i];
     }
 }
 
 // Helper function for set_tableaux - not exported
 void set_conversion_tables(Tableaux *T) {
-    T->indices_B = zero_vector(T->size_B);
-    T->indices_N = zero_vector(T->size_N);
     unsigned int i, count;
     count = 0;
     for (i = 0; i < T->size; i++) {
@@ -106,71 +295,134 @@ void set_conversion_tables(Tableaux *T) {
 }
 
 // Helper function for set_tableaux - not exported
-void set_r_and_sizes(Tableaux *T) { 
+void set_r(Tableaux *T) { 
     // Compute helper vectors c_B and c_N
-    Vector *cB = subind_vector(T->P->c, T->B);
-    Vector *cN = subind_vector(T->P->c, T->N);
+    size_t mark = workspace_mark(T->W);
+    Vector cB = workspace_vector(T->W, T->size_B);
+    Vector cN = workspace_vector(T->W, T->size_N);
+    subind_to_vector(T->P->c, T->B, &cB);
+    subind_to_vector(T->P->c, T->N, &cN);
 
     // Compute r = c_N - (c_B^t * Q)^t = Q^t * c_B
-    T->r = copy_vector(cN);
-    Matrix *Qt = trans_matrix(T->Q);
-    Vector *temp = mult_vector(Qt, cB);
-    add_to_vector(T->r, temp);
-    free_matrix(Qt);
-    free_vector(temp);
+    mult_trans_to_vector(T->Q, &cB, T->r);
+    add_to_vector(T->r, &cN);
 
     // Compute z0
-    T->z0 = inner_product(cB, T->p);
-
-    // Set sizes for later referencing
-    T->size_B = cB->size;
-    T->size_N = cN->size;
-    T->size = T->size_B + T->size_N;
-    
-    // Free structures
-    free_vector(cB);
-    free_vector(cN);
+    T->z0 = inner_product(&cB, T->p);
+    workspace_release(T->W, mark);
 }
 
 void set_p_and_Q(Tableaux *T) {
-    // Compute helper matrices A_B, A_N and (A_B)^-1
-    Matrix *A = T->P->A;
-    Matrix* AB = subind_matrix(A, T->B);
-    Matrix* AN = subind_matrix(A, T->N);
-    Matrix* ABinv = inverse_matrix(AB);
-
-    // Compute p and Q
-    T->p = mult_vector(ABinv, T->P->b);
-    T->Q = mult_matrix(ABinv, AN);
-    scalar_to_matrix(T->Q, -1);
+    // Factor A_B once and compute p = (A_B)^-1 b from it
+    SparseMatrix *A = T->P->A;
+    size_t mark = workspace_mark(T->W);
+    Matrix LU = workspace_matrix(T->W, T->size_B, T->size_B);
+    Vector perm = workspace_vector(T->W, T->size_B);
+    sparse_subind_to_matrix(A, T->B, &LU);
+    LU_decomp(&LU, &perm);
+    copy_to_vector(T->P->b, T->p);
+    LU_solve_workspace(&LU, &perm, T->p, T->W);
 
-    // Free structures 
-    free_matrix(AB);
-    free_matrix(AN);
-    free_matrix(ABinv);
+    // Compute Q = -(A_B)^-1 A_N one column at a time, straight from the
+    // non-zeros of the columns of A, without forming (A_B)^-1 or a dense A_N
+    Vector inv_perm = workspace_vector(T->W, T->size_B);
+    Vector q;
+    int i, j;
+    for (i = 0; i < T->size_B; i++)
+        inv_perm.entries[(int)perm.entries[i]] = i;
+    for (j = 0; j < T->size_N; j++) {
+        q = col_view(T->Q, j);
+        LU_solve_sparse(&LU, &inv_perm, A, (int)T->indices_N->entries[j], &q);
+    }
+    scalar_to_matrix(T->Q, -1);
+    workspace_release(T->W, mark);
 }
 
 void set_tableaux(Tableaux *T, Vector *basis) {
-    
-    // Release previous structures
-    if (T->initialized == 1)
-        partial_free_tableaux(T);
-    
+    T->pivots = 0;
+    T->num_candidates = 0;
+
     // Set basic / non-basic variables
-    T->B = copy_vector(basis);
-    T->N = swap_zero_nonzero(T->B);
+    unsigned int i;
+    copy_to_vector(basis, T->B);
+    for (i = 0; i < T->B->size; i++)
+        T->N->entries[i] = (T->B->entries[i] == 0);
+
+    // Set index conversion tables
+    set_conversion_tables(T);
 
     // Set p and Q
     set_p_and_Q(T);
 
-    // Set r and some sizes for later reference
-    set_r_and_sizes(T); 
-
-    // Set index conversion tables
-    set_conversion_tables(T);
+    // Set r
+    set_r(T); 
 
     // Compute the basic solution
-    set_basic_solution(T);
+    fill_basic_solution(T);
+}
+
+void pivot_tableaux(Tableaux *T, Vector *basis, int alpha, int beta) {
+    // Periodically start over to get rid of accumulated rounding errors
+    if (T->pivots + 1 >= REFACTOR_FREQ) {
+        set_tableaux(T, basis);
+        return;
+    }
+
+    Matrix *Q = T->Q;
+    double *p = T->p->entries;
+    double *r = T->r->entries;
+    double piv = ENTRY(Q, beta, alpha);
+    double f, q, *col;
+    int i, j;
+
+    // Solve row beta for the entering variable, which then takes
+    // the place of the leaving variable (and vice versa). Harris' ratio
+    // test may choose a leaving variable slightly below zero, which must
+    // not make the step negative.
+    if (p[beta] < 0)
+        p[beta] = 0;
+    p[beta] = -p[beta] / piv;
+    for (j = 0; j < T->size_N; j++)
+        ENTRY(Q, beta, j) = -ENTRY(Q, beta, j) / piv;
+    ENTRY(Q, beta, alpha) = 1 / piv;
+
+    // Substitute the new row beta into all other rows and into r. The
+    // multipliers are the old column alpha, which is then replaced.
+    size_t mark = workspace_mark(T->W);
+    Vector mult = workspace_vector(T->W, T->size_B);
+    copy_col(Q, &mult, alpha);
+    mult.entries[beta] = 0;
+    col = COL(Q, alpha);
+    for (i = 0; i < T->size_B; i++) {
+        if (i != beta)
+            col[i] = 0;
+    }
+    kernel_axpy(p, p[beta], mult.entries, T->size_B);
+    for (j = 0; j < T->size_N; j++) {
+        q = ENTRY(Q, beta, j);
+        if (q != 0)
+            kernel_axpy(COL(Q, j), q, mult.entries, T->size_B);
+    }
+    workspace_release(T->W, mark);
+
+    f = r[alpha];
+    T->z0 += f * p[beta];
+    r[alpha] = 0;
+    for (j = 0; j < T->size_N; j++)
+        r[j] += f * ENTRY(Q, beta, j);
+
+    // Update bitmasks and conversion tables
+    int entering = (int) T->indices_N->entries[alpha];
+    int leaving = (int) T->indices_B->entries[beta];
+    T->B->entries[entering] = 1;
+    T->B->entries[leaving] = 0;
+    T->N->entries[entering] = 0;
+    T->N->entries[leaving] = 1;
+    T->indices_B->entries[beta] = entering;
+    T->indices_N->entries[alpha] = leaving;
+
+    fill_basic_solution(T);
+    T->pivots++;
 }
 
 void print_tableaux(Tableaux *T) {
@@ -200,24 +452,48 @@ void print_tableaux(Tableaux *T) {
 
 void print_LP(LP *P) {
     printf("A = \n");
-    print_matrix(P->A);
+    print_sparse_matrix(P->A);
     printf("trans(b) = \n");
     print_vector(P->b);
     printf("trans(c) = \n");
     print_vector(P->c);
 }
 
-void partial_free_tableaux(Tableaux *T) {
-    free_vector(T->B);
-    free_vector(T->N);
-    free_vector(T->p);
-    free_vector(T->r);
-    free_matrix(T->Q);
-    
-    free_vector(T->indices_B);
-    free_vector(T->indices_N);
+Vector *read_basis(const char *filename, unsigned int n, unsigned int m) {
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL)
+        runtime_error("read_basis: could not open file");
+    unsigned int file_n, file_m, i, index;
+    if (fscanf(fp, "%u %u", &file_n, &file_m) != 2 || file_n != n || file_m > m) {
+        fclose(fp);
+        runtime_error("read_basis: basis does not fit LP");
+    }
+    Vector *basis = zero_vector(n);
+    for (i = 0; i < file_m; i++) {
+        if (fscanf(fp, "%u", &index) != 1 || index >= n || basis->entries[index] != 0) {
+            fclose(fp);
+            free_vector(basis);
+            runtime_error("read_basis: invalid basis");
+        }
+        basis->entries[index] = 1;
+    }
+    fclose(fp);
+    return basis;
+}
 
-    free_vector(T->x);
+void write_basis(const char *filename, const Vector *basis) {
+    FILE *fp = fopen(filename, "w");
+    if (fp == NULL)
+        runtime_error("write_basis: could not open file");
+    unsigned int i, m = 0;
+    for (i = 0; i < basis->size; i++)
+        m += (basis->entries[i] != 0);
+    fprintf(fp, "%u %u\n", basis->size, m);
+    for (i = 0; i < basis->size; i++) {
+        if (basis->entries[i] != 0)
+            fprintf(fp, "%u\n", i);
+    }
+    fclose(fp);
 }
 
 void free_tableaux(Tableaux *T) {
@@ -231,12 +507,16 @@ void free_tableaux(Tableaux *T) {
     free_vector(T->indices_N);
     
     free_vector(T->x);
+    free_workspace(T->W);
+
+    if (T->weights)
+        free_vector(T->weights);
     
     free(T);
 }
 
 void free_LP(LP *P) {
-    free_matrix(P->A);
+    free_sparse_matrix(P->A);
     free_vector(P->b);
     free_vector(P->c);
     free(P);       
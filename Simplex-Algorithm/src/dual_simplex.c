@@ -0,0 +1,126 @@
+#include "dual_simplex.h"
+
+// Helper function for dual_solve_LP_basis - not exported
+// Choose the basic variable to leave: the one with the most negative value,
+// below -harris_tol. Return -1 if there is none, that is if the basis is
+// primal feasible.
+int dual_choose_beta(const RevisedBasis *R) {
+    int i, best = -1;
+    for (i = 0; i < R->size_B; i++) {
+        if (R->x_B->entries[i] < -simplex_params.harris_tol && (best == -1 ||
+                R->x_B->entries[i] < R->x_B->entries[best]))
+            best = i;
+    }
+    return best;
+}
+
+// Helper function for dual_solve_LP_basis - not exported
+// Dual ratio test: for the pivot row rho^t A, where rho = ((A_B)^t)^-1
+// e_beta, choose the non-basic variable with a negative entry a_j there
+// that minimizes d_j / a_j, so that all reduced costs d stay <= 0. As in
+// ratio_test, entries only count as negative below -PIVOT_TOL times the
+// largest |a_j| of the row, which is at least the 1 of the leaving
+// variable. The row is stored in row. Ties are broken towards the larger
+// |a_j|. Return -1 if there is none, which proves the LP infeasible.
+int dual_choose_alpha(const RevisedBasis *R, const Vector *y, const Vector *rho, Vector *row) {
+    int j, best = -1;
+    double a, best_a = 0, d, cur_value, best_value = 0, piv_tol = 1;
+    for (j = 0; j < R->size; j++) {
+        row->entries[j] = 0;
+        if (R->B->entries[j] != 0)
+            continue;
+        row->entries[j] = sparse_col_product(R->P->A, j, rho);
+        if (fabs(row->entries[j]) > piv_tol)
+            piv_tol = fabs(row->entries[j]);
+    }
+    piv_tol *= PIVOT_TOL;
+
+    for (j = 0; j < R->size; j++) {
+        a = row->entries[j];
+        if (R->B->entries[j] != 0 || a >= -piv_tol)
+            continue;
+        d = reduced_cost(R, y, j);
+        cur_value = (d < 0 ? d : 0) / a;
+        if (best == -1 || cur_value < best_value || (cur_value == best_value && a < best_a)) {
+            best = j;
+            best_a = a;
+            best_value = cur_value;
+        }
+    }
+    return best;
+}
+
+int dual_solve_LP_basis(LP *P, Vector *basis, Vector *ret) {
+    RevisedBasis *R = build_dual_basis(P, basis);
+    Vector *y = zero_vector(R->size_B);
+    Vector *rho = zero_vector(R->size_B);
+    Vector *row = zero_vector(R->size);
+    int alpha, beta, j, result = 0;
+
+    // Check dual feasibility
+    dual_values(R, y);
+    for (j = 0; j < R->size; j++) {
+        if (reduced_cost(R, y, j) > ZERO_TOL) {
+            result = 2;
+            break;
+        }
+    }
+
+    // Keep pivoting until no basic variable is negative
+    while (result == 0 && (beta = dual_choose_beta(R)) != -1) {
+        reset_vector(rho);
+        rho->entries[beta] = 1;
+        btran(R, rho);
+        dual_values(R, y);
+        alpha = dual_choose_alpha(R, y, rho, row);
+
+        // LP infeasible
+        if (alpha == -1) {
+            result = 1;
+            break;
+        }
+        pivot_revised_basis(R, alpha, beta, entering_column(R, alpha));
+        simplex_stats.pivots++;
+    }
+
+    // Store the basic solution, without the negative values it may have
+    // within the tolerance
+    if (result == 0) {
+        reset_vector(ret);
+        for (j = 0; j < R->size_B; j++) {
+            if (R->x_B->entries[j] > 0)
+                ret->entries[(int)R->indices_B->entries[j]] = R->x_B->entries[j];
+        }
+    }
+    copy_to_vector(R->B, basis);
+
+    free_vector(y);
+    free_vector(rho);
+    free_vector(row);
+    free_revised_basis(R);
+    return result;
+}
+
+int reoptimize_LP(LP *P, Vector *basis, int pivot_rule, Vector *ret) {
+
+    // Check m <= n
+    if (P->A->size_r > P->A->size_c)
+        return WRONG_FORM;
+    memset(&simplex_stats, 0, sizeof(SimplexStats));
+
+    remove_rows_for_basis(P, basis);
+    switch (check_basis(P, basis)) {
+        case BASIS_FEASIBLE:
+            if (revised_solve_LP_basis(P, basis, pivot_rule, ret) == 0)
+                return SOLVABLE;
+            return UNBOUNDED;
+        case BASIS_INFEASIBLE:
+            switch (dual_solve_LP_basis(P, basis, ret)) {
+                case 0:
+                    return SOLVABLE;
+                case 1:
+                    return INFEASIBLE;
+            }
+    }
+    return revised_solve_LP_final_basis(P, pivot_rule, basis, ret);
+}
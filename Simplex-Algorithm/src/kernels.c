@@ -0,0 +1,424 @@
+#include "kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(NO_SIMD)
+#define KERNELS_X86
+#include <immintrin.h>
+#endif
+
+// Block sizes for kernel_gemm: rows and depth of the block of A kept in cache
+#define GEMM_MC 128
+#define GEMM_KC 256
+// Columns of C per register block
+#define GEMM_NR 4
+
+// Structure for a set of kernels
+typedef struct {
+    int level;
+    const char *name;
+    double (*dot)(const double *, const double *, int);
+    void (*axpy)(double *, double, const double *, int);
+    void (*add)(double *, const double *, int);
+    void (*sub)(double *, const double *, int);
+    void (*scale)(double *, double, int);
+
+    // Register block of kernel_gemm, C(0:mr, 0:GEMM_NR) += A(0:mr, 0:k) B(0:k, 0:GEMM_NR)
+    void (*micro)(int k, const double *A, int lda, const double *B, int ldb,
+            double *C, int ldc);
+    int mr;     // Rows per register block, 0 if there is no register block
+} KernelSet;
+
+// Kernels in use - not exported
+KernelSet kernel_set;
+int kernels_ready = 0;
+
+// Portable kernels - not exported
+
+double generic_dot(const double *a, const double *b, int n) {
+    int i;
+    double res = 0;
+    for (i = 0; i < n; i++)
+        res += a[i] * b[i];
+    return res;
+}
+
+void generic_axpy(double *y, double l, const double *x, int n) {
+    int i;
+    for (i = 0; i < n; i++)
+        y[i] += l * x[i];
+}
+
+void generic_add(double *a, const double *b, int n) {
+    int i;
+    for (i = 0; i < n; i++)
+        a[i] += b[i];
+}
+
+void generic_sub(double *a, const double *b, int n) {
+    int i;
+    for (i = 0; i < n; i++)
+        a[i] -= b[i];
+}
+
+void generic_scale(double *a, double l, int n) {
+    int i;
+    for (i = 0; i < n; i++)
+        a[i] *= l;
+}
+
+#ifdef KERNELS_X86
+
+// AVX2 kernels, four doubles per register. They end with vzeroupper (which
+// the compiler leaves out without optimization), since otherwise the next
+// SSE instruction pays for the dirty upper halves - not exported
+
+__attribute__((target("avx2,fma")))
+double avx2_dot(const double *a, const double *b, int n) {
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    double t[4], res;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), s1);
+    }
+    if (i + 4 <= n) {
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+        i += 4;
+    }
+    _mm256_storeu_pd(t, _mm256_add_pd(s0, s1));
+    res = (t[0] + t[1]) + (t[2] + t[3]);
+    for (; i < n; i++)
+        res += a[i] * b[i];
+    _mm256_zeroupper();
+    return res;
+}
+
+__attribute__((target("avx2,fma")))
+void avx2_axpy(double *y, double l, const double *x, int n) {
+    __m256d vl = _mm256_set1_pd(l);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(vl, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+        _mm256_storeu_pd(y + i + 4, _mm256_fmadd_pd(vl, _mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4)));
+    }
+    for (; i + 4 <= n; i += 4)
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(vl, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    for (; i < n; i++)
+        y[i] += l * x[i];
+    _mm256_zeroupper();
+}
+
+__attribute__((target("avx2,fma")))
+void avx2_add(double *a, const double *b, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_pd(a + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        _mm256_storeu_pd(a + i + 4, _mm256_add_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    for (; i + 4 <= n; i += 4)
+        _mm256_storeu_pd(a + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    for (; i < n; i++)
+        a[i] += b[i];
+    _mm256_zeroupper();
+}
+
+__attribute__((target("avx2,fma")))
+void avx2_sub(double *a, const double *b, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_pd(a + i, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        _mm256_storeu_pd(a + i + 4, _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    for (; i + 4 <= n; i += 4)
+        _mm256_storeu_pd(a + i, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    for (; i < n; i++)
+        a[i] -= b[i];
+    _mm256_zeroupper();
+}
+
+__attribute__((target("avx2,fma")))
+void avx2_scale(double *a, double l, int n) {
+    __m256d vl = _mm256_set1_pd(l);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_pd(a + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), vl));
+        _mm256_storeu_pd(a + i + 4, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), vl));
+    }
+    for (; i + 4 <= n; i += 4)
+        _mm256_storeu_pd(a + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), vl));
+    for (; i < n; i++)
+        a[i] *= l;
+    _mm256_zeroupper();
+}
+
+// 8 x 4 register block: two registers per column of C
+__attribute__((target("avx2,fma")))
+void avx2_micro(int k, const double *A, int lda, const double *B, int ldb,
+        double *C, int ldc) {
+    const double *B1 = B + ldb, *B2 = B + 2 * ldb, *B3 = B + 3 * ldb;
+    double *C1 = C + ldc, *C2 = C + 2 * ldc, *C3 = C + 3 * ldc;
+    __m256d c00 = _mm256_loadu_pd(C), c10 = _mm256_loadu_pd(C + 4);
+    __m256d c01 = _mm256_loadu_pd(C1), c11 = _mm256_loadu_pd(C1 + 4);
+    __m256d c02 = _mm256_loadu_pd(C2), c12 = _mm256_loadu_pd(C2 + 4);
+    __m256d c03 = _mm256_loadu_pd(C3), c13 = _mm256_loadu_pd(C3 + 4);
+    __m256d a0, a1, b;
+    int p;
+    for (p = 0; p < k; p++, A += lda) {
+        a0 = _mm256_loadu_pd(A);
+        a1 = _mm256_loadu_pd(A + 4);
+        b = _mm256_broadcast_sd(B + p);
+        c00 = _mm256_fmadd_pd(a0, b, c00);
+        c10 = _mm256_fmadd_pd(a1, b, c10);
+        b = _mm256_broadcast_sd(B1 + p);
+        c01 = _mm256_fmadd_pd(a0, b, c01);
+        c11 = _mm256_fmadd_pd(a1, b, c11);
+        b = _mm256_broadcast_sd(B2 + p);
+        c02 = _mm256_fmadd_pd(a0, b, c02);
+        c12 = _mm256_fmadd_pd(a1, b, c12);
+        b = _mm256_broadcast_sd(B3 + p);
+        c03 = _mm256_fmadd_pd(a0, b, c03);
+        c13 = _mm256_fmadd_pd(a1, b, c13);
+    }
+    _mm256_storeu_pd(C, c00);
+    _mm256_storeu_pd(C + 4, c10);
+    _mm256_storeu_pd(C1, c01);
+    _mm256_storeu_pd(C1 + 4, c11);
+    _mm256_storeu_pd(C2, c02);
+    _mm256_storeu_pd(C2 + 4, c12);
+    _mm256_storeu_pd(C3, c03);
+    _mm256_storeu_pd(C3 + 4, c13);
+    _mm256_zeroupper();
+}
+
+// AVX-512 kernels, eight doubles per register; the tails use masked loads
+// and stores. They end with vzeroupper as well - not exported
+
+__attribute__((target("avx512f")))
+double avx512_dot(const double *a, const double *b, int n) {
+    __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+    __mmask8 mask;
+    double res;
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), s0);
+        s1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8), s1);
+    }
+    for (; i < n; i += 8) {
+        mask = (n - i >= 8 ? 0xFF : (1 << (n - i)) - 1);
+        s0 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, a + i),
+                _mm512_maskz_loadu_pd(mask, b + i), s0);
+    }
+    res = _mm512_reduce_add_pd(_mm512_add_pd(s0, s1));
+    _mm256_zeroupper();
+    return res;
+}
+
+__attribute__((target("avx512f")))
+void avx512_axpy(double *y, double l, const double *x, int n) {
+    __m512d vl = _mm512_set1_pd(l);
+    __mmask8 mask;
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_pd(y + i, _mm512_fmadd_pd(vl, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+        _mm512_storeu_pd(y + i + 8, _mm512_fmadd_pd(vl, _mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8)));
+    }
+    for (; i < n; i += 8) {
+        mask = (n - i >= 8 ? 0xFF : (1 << (n - i)) - 1);
+        _mm512_mask_storeu_pd(y + i, mask, _mm512_fmadd_pd(vl,
+                _mm512_maskz_loadu_pd(mask, x + i), _mm512_maskz_loadu_pd(mask, y + i)));
+    }
+    _mm256_zeroupper();
+}
+
+__attribute__((target("avx512f")))
+void avx512_add(double *a, const double *b, int n) {
+    __mmask8 mask;
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_pd(a + i, _mm512_add_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+        _mm512_storeu_pd(a + i + 8, _mm512_add_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8)));
+    }
+    for (; i < n; i += 8) {
+        mask = (n - i >= 8 ? 0xFF : (1 << (n - i)) - 1);
+        _mm512_mask_storeu_pd(a + i, mask, _mm512_add_pd(_mm512_maskz_loadu_pd(mask, a + i),
+                _mm512_maskz_loadu_pd(mask, b + i)));
+    }
+    _mm256_zeroupper();
+}
+
+__attribute__((target("avx512f")))
+void avx512_sub(double *a, const double *b, int n) {
+    __mmask8 mask;
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_pd(a + i, _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+        _mm512_storeu_pd(a + i + 8, _mm512_sub_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8)));
+    }
+    for (; i < n; i += 8) {
+        mask = (n - i >= 8 ? 0xFF : (1 << (n - i)) - 1);
+        _mm512_mask_storeu_pd(a + i, mask, _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, a + i),
+                _mm512_maskz_loadu_pd(mask, b + i)));
+    }
+    _mm256_zeroupper();
+}
+
+__attribute__((target("avx512f")))
+void avx512_scale(double *a, double l, int n) {
+    __m512d vl = _mm512_set1_pd(l);
+    __mmask8 mask;
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_pd(a + i, _mm512_mul_pd(_mm512_loadu_pd(a + i), vl));
+        _mm512_storeu_pd(a + i + 8, _mm512_mul_pd(_mm512_loadu_pd(a + i + 8), vl));
+    }
+    for (; i < n; i += 8) {
+        mask = (n - i >= 8 ? 0xFF : (1 << (n - i)) - 1);
+        _mm512_mask_storeu_pd(a + i, mask, _mm512_mul_pd(_mm512_maskz_loadu_pd(mask, a + i), vl));
+    }
+    _mm256_zeroupper();
+}
+
+// 16 x 4 register block: two registers per column of C
+__attribute__((target("avx512f")))
+void avx512_micro(int k, const double *A, int lda, const double *B, int ldb,
+        double *C, int ldc) {
+    const double *B1 = B + ldb, *B2 = B + 2 * ldb, *B3 = B + 3 * ldb;
+    double *C1 = C + ldc, *C2 = C + 2 * ldc, *C3 = C + 3 * ldc;
+    __m512d c00 = _mm512_loadu_pd(C), c10 = _mm512_loadu_pd(C + 8);
+    __m512d c01 = _mm512_loadu_pd(C1), c11 = _mm512_loadu_pd(C1 + 8);
+    __m512d c02 = _mm512_loadu_pd(C2), c12 = _mm512_loadu_pd(C2 + 8);
+    __m512d c03 = _mm512_loadu_pd(C3), c13 = _mm512_loadu_pd(C3 + 8);
+    __m512d a0, a1, b;
+    int p;
+    for (p = 0; p < k; p++, A += lda) {
+        a0 = _mm512_loadu_pd(A);
+        a1 = _mm512_loadu_pd(A + 8);
+        b = _mm512_set1_pd(B[p]);
+        c00 = _mm512_fmadd_pd(a0, b, c00);
+        c10 = _mm512_fmadd_pd(a1, b, c10);
+        b = _mm512_set1_pd(B1[p]);
+        c01 = _mm512_fmadd_pd(a0, b, c01);
+        c11 = _mm512_fmadd_pd(a1, b, c11);
+        b = _mm512_set1_pd(B2[p]);
+        c02 = _mm512_fmadd_pd(a0, b, c02);
+        c12 = _mm512_fmadd_pd(a1, b, c12);
+        b = _mm512_set1_pd(B3[p]);
+        c03 = _mm512_fmadd_pd(a0, b, c03);
+        c13 = _mm512_fmadd_pd(a1, b, c13);
+    }
+    _mm512_storeu_pd(C, c00);
+    _mm512_storeu_pd(C + 8, c10);
+    _mm512_storeu_pd(C1, c01);
+    _mm512_storeu_pd(C1 + 8, c11);
+    _mm512_storeu_pd(C2, c02);
+    _mm512_storeu_pd(C2 + 8, c12);
+    _mm512_storeu_pd(C3, c03);
+    _mm512_storeu_pd(C3 + 8, c13);
+    _mm256_zeroupper();
+}
+
+#endif
+
+void kernels_select(int level) {
+    KernelSet generic = {KERNELS_GENERIC, "generic", generic_dot, generic_axpy,
+        generic_add, generic_sub, generic_scale, NULL, 0};
+    kernel_set = generic;
+#ifdef KERNELS_X86
+    __builtin_cpu_init();
+    if (level >= KERNELS_AVX2 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        KernelSet avx2 = {KERNELS_AVX2, "avx2", avx2_dot, avx2_axpy, avx2_add,
+            avx2_sub, avx2_scale, avx2_micro, 8};
+        kernel_set = avx2;
+    }
+    if (level >= KERNELS_AVX512 && __builtin_cpu_supports("avx512f")) {
+        KernelSet avx512 = {KERNELS_AVX512, "avx512", avx512_dot, avx512_axpy,
+            avx512_add, avx512_sub, avx512_scale, avx512_micro, 16};
+        kernel_set = avx512;
+    }
+#endif
+    kernels_ready = 1;
+}
+
+const char *kernels_name(void) {
+    if (!kernels_ready)
+        kernels_select(KERNELS_AVX512);
+    return kernel_set.name;
+}
+
+double kernel_dot(const double *a, const double *b, int n) {
+    if (!kernels_ready)
+        kernels_select(KERNELS_AVX512);
+    return kernel_set.dot(a, b, n);
+}
+
+void kernel_axpy(double *y, double l, const double *x, int n) {
+    if (!kernels_ready)
+        kernels_select(KERNELS_AVX512);
+    kernel_set.axpy(y, l, x, n);
+}
+
+void kernel_add(double *a, const double *b, int n) {
+    if (!kernels_ready)
+        kernels_select(KERNELS_AVX512);
+    kernel_set.add(a, b, n);
+}
+
+void kernel_sub(double *a, const double *b, int n) {
+    if (!kernels_ready)
+        kernels_select(KERNELS_AVX512);
+    kernel_set.sub(a, b, n);
+}
+
+void kernel_scale(double *a, double l, int n) {
+    if (!kernels_ready)
+        kernels_select(KERNELS_AVX512);
+    kernel_set.scale(a, l, n);
+}
+
+// Helper function for kernel_gemm - not exported
+// C += AB for the blocks that do not fill a register block, one column of
+// C at a time, skipping zeros of B
+void gemm_fringe(int m, int n, int k, const double *A, int lda,
+        const double *B, int ldb, double *C, int ldc) {
+    int j, p;
+    for (j = 0; j < n; j++) {
+        for (p = 0; p < k; p++) {
+            if (B[(size_t)j * ldb + p] != 0)
+                kernel_set.axpy(C + (size_t)j * ldc, B[(size_t)j * ldb + p], A + (size_t)p * lda, m);
+        }
+    }
+}
+
+void kernel_gemm(int m, int n, int k, const double *A, int lda,
+        const double *B, int ldb, double *C, int ldc) {
+    if (!kernels_ready)
+        kernels_select(KERNELS_AVX512);
+
+    int mr = kernel_set.mr;
+    int i, j, i0, p0, mc, kc;
+    const double *A_blk, *B_blk;
+    double *C_blk;
+
+    // Go through A in blocks of GEMM_MC x GEMM_KC, which stay in cache while
+    // they are multiplied with all columns of B
+    for (p0 = 0; p0 < k; p0 += GEMM_KC) {
+        kc = (k - p0 < GEMM_KC ? k - p0 : GEMM_KC);
+        for (i0 = 0; i0 < m; i0 += GEMM_MC) {
+            mc = (m - i0 < GEMM_MC ? m - i0 : GEMM_MC);
+            A_blk = A + (size_t)p0 * lda + i0;
+            for (j = 0; j + GEMM_NR <= n; j += GEMM_NR) {
+                B_blk = B + (size_t)j * ldb + p0;
+                C_blk = C + (size_t)j * ldc + i0;
+                i = 0;
+                if (mr > 0) {
+                    for (; i + mr <= mc; i += mr)
+                        kernel_set.micro(kc, A_blk + i, lda, B_blk, ldb, C_blk + i, ldc);
+                }
+                if (i < mc)
+                    gemm_fringe(mc - i, GEMM_NR, kc, A_blk + i, lda, B_blk, ldb, C_blk + i, ldc);
+            }
+            if (j < n)
+                gemm_fringe(mc, n - j, kc, A_blk, lda, B + (size_t)j * ldb + p0, ldb,
+                        C + (size_t)j * ldc + i0, ldc);
+        }
+    }
+}
@@ -4,29 +4,20 @@ Matrix *inverse_matrix(const Matrix *A) {
     if (A->size_r != A->size_c)
         runtime_error("inverse_matrix: matrix should be square");
 
-    // Find a QR-decomposition of A
-    Matrix *Q = zero_matrix(A->size_r, A->size_c);
-    Matrix *R = zero_matrix(A->size_c, A->size_c);
-    QR_decomp(A, Q, R);
+    // Factor A once and solve AX = I for all columns at the same time
+    Matrix *QR = zero_matrix(A->size_r, A->size_c);
+    Vector *tau = zero_vector(A->size_c);
+    memcpy(QR->entries, A->entries, (size_t)A->size_c * A->ld * sizeof(double));
+    householder_QR(QR, tau);
 
-    if (rank_R(R) < A->size_c) {
-        runtime_error("inverse_matrix: matrix singular");
-    }
     Matrix *ret = zero_matrix(A->size_r, A->size_c);
-
-    // Solve Ax = e_i for all basis vectors
     unsigned int i;
-    for (i = 0; i < A->size_c; i ++) {
-        Vector *e = zero_vector(A->size_c);
-        e->entries[i] = 1;
-        Vector *sol = solve_system_QR(Q, R, e);
-        replace_col(ret, sol, i);
-        // This freeing is suboptimal
-        free_vector(e);
-        free_vector(sol);
-    }
-    free_matrix(Q);
-    free_matrix(R);
+    for (i = 0; i < A->size_c; i++)
+        ENTRY(ret, i, i) = 1;
+    QR_solve_matrix(QR, tau, ret);
+
+    free_matrix(QR);
+    free_vector(tau);
     return ret;
 }
 
@@ -36,17 +27,16 @@ Vector *solve_system(const Matrix *A, const Vector *b) {
     if (A->size_r != b->size)
         runtime_error("solve_system: incompatible sizes");
 
-    // Find a QR-decomposition of A and multiply Q^t b
-    Matrix *Q = zero_matrix(A->size_r, A->size_c);
-    Matrix *R = zero_matrix(A->size_c, A->size_c);
-    QR_decomp(A, Q, R);
+    Matrix *QR = zero_matrix(A->size_r, A->size_c);
+    Vector *tau = zero_vector(A->size_c);
+    memcpy(QR->entries, A->entries, (size_t)A->size_c * A->ld * sizeof(double));
+    householder_QR(QR, tau);
 
-    if (rank_R(R) < A->size_c)
-        runtime_error("solve_system: matrix should be of full rank");
+    Vector *ret = copy_vector(b);
+    QR_solve(QR, tau, ret);
 
-    Vector *ret = solve_system_QR(Q, R, b);
-    free_matrix(Q);
-    free_matrix(R);
+    free_matrix(QR);
+    free_vector(tau);
     return ret;
 }
 
@@ -67,51 +57,387 @@ Vector *solve_system_QR(const Matrix *Q, const Matrix *R, const Vector *b) {
     for (i = ret->size - 1; i >= 0; i--) {
         val = Qtb->entries[i];
         for (j = ret->size - 1; j > i; j--) {
-            val -= ret->entries[j] * R->entries[i][j];    
+            val -= ret->entries[j] * ENTRY(R, i, j);
         }
         if (val == 0) {
             ret->entries[i] = 0;
         }
         else {
             // No solution
-            if (is_zero(R->entries[i][i])) {
+            if (is_zero(ENTRY(R, i, i))) {
                 runtime_error("solve_system_QR: system has no solution");
             }
-            ret->entries[i] = val / R->entries[i][i];
+            ret->entries[i] = val / ENTRY(R, i, i);
         }
     }
     free_vector(Qtb);
     return ret;
 }
 
+void LU_decomp(Matrix *A, Vector *perm) {
+    if (try_LU_decomp(A, perm) != 0)
+        runtime_error("LU_decomp: matrix singular");
+}
+
+int try_LU_decomp(Matrix *A, Vector *perm) {
+    if (A->size_r != A->size_c)
+        runtime_error("LU_decomp: matrix should be square");
+    if (perm->size != A->size_r)
+        runtime_error("LU_decomp: permutation of wrong size");
+
+    double *col, *col_k;
+    double l, col_max;
+    unsigned int i, j, k, pivot;
+    for (i = 0; i < perm->size; i++)
+        perm->entries[i] = i;
+
+    for (k = 0; k < A->size_c; k++) {
+        // Find the largest entry in column k on or below the diagonal
+        col_k = COL(A, k);
+        pivot = k;
+        for (i = k + 1; i < A->size_r; i++) {
+            if (fabs(col_k[i]) > fabs(col_k[pivot]))
+                pivot = i;
+        }
+
+        // Column k is (nearly) a combination of the previous ones if what is
+        // left of it below the diagonal is small compared to the whole column
+        col_max = fabs(col_k[pivot]);
+        for (i = 0; i < k; i++) {
+            if (fabs(col_k[i]) > col_max)
+                col_max = fabs(col_k[i]);
+        }
+        if (col_max == 0 || fabs(col_k[pivot]) <= PIVOT_TOL * col_max)
+            return 1;
+
+        // Swap it into place
+        if (pivot != k) {
+            for (j = 0; j < A->size_c; j++) {
+                l = ENTRY(A, k, j);
+                ENTRY(A, k, j) = ENTRY(A, pivot, j);
+                ENTRY(A, pivot, j) = l;
+            }
+            l = perm->entries[k];
+            perm->entries[k] = perm->entries[pivot];
+            perm->entries[pivot] = l;
+        }
+
+        // Compute column k of L and eliminate the entries below the 
+        // diagonal in the remaining columns, one column at a time
+        kernel_scale(col_k + k + 1, 1 / col_k[k], A->size_r - k - 1);
+        for (j = k + 1; j < A->size_c; j++) {
+            col = COL(A, j);
+            l = col[k];
+            if (l != 0)
+                kernel_axpy(col + k + 1, -l, col_k + k + 1, A->size_r - k - 1);
+        }
+    }
+    return 0;
+}
+
+// Helper function for the LU_solve functions - not exported
+// Overwrite x by (LU)^-1 x, for an already permuted right-hand side x
+void LU_substitute(const Matrix *LU, double *x) {
+    double *col;
+    int k, n = LU->size_r;
+
+    // Forward substitution with L, skipping zeros of the right-hand side
+    for (k = 0; k < n; k++) {
+        if (x[k] != 0)
+            kernel_axpy(x + k + 1, -x[k], COL(LU, k) + k + 1, n - k - 1);
+    }
+    // Back-substitution with U
+    for (k = n - 1; k >= 0; k--) {
+        if (x[k] == 0)
+            continue;
+        col = COL(LU, k);
+        x[k] /= col[k];
+        kernel_axpy(x, -x[k], col, k);
+    }
+}
+
+// Helper function for the LU_solve functions - not exported
+// Overwrite x by (PA)^-1 x, using temp (of the same size) as scratch space
+void LU_solve_col(const Matrix *LU, const Vector *perm, double *x, double *temp) {
+    int i, n = LU->size_r;
+
+    // Apply the permutation
+    memcpy(temp, x, n * sizeof(double));
+    for (i = 0; i < n; i++)
+        x[i] = temp[(int)perm->entries[i]];
+    LU_substitute(LU, x);
+}
+
+void LU_solve(const Matrix *LU, const Vector *perm, Vector *b) {
+    if (LU->size_r != b->size)
+        runtime_error("LU_solve: incompatible sizes");
+
+    Vector *temp = zero_vector(b->size);
+    LU_solve_col(LU, perm, b->entries, temp->entries);
+    free_vector(temp);
+}
+
+void LU_solve_matrix(const Matrix *LU, const Vector *perm, Matrix *B) {
+    if (LU->size_r != B->size_r)
+        runtime_error("LU_solve_matrix: incompatible sizes");
+
+    Vector *temp = zero_vector(B->size_r);
+    unsigned int j;
+    for (j = 0; j < B->size_c; j++)
+        LU_solve_col(LU, perm, COL(B, j), temp->entries);
+    free_vector(temp);
+}
+
+void LU_solve_workspace(const Matrix *LU, const Vector *perm, Vector *b, Workspace *W) {
+    if (LU->size_r != b->size)
+        runtime_error("LU_solve_workspace: incompatible sizes");
+
+    size_t mark = workspace_mark(W);
+    Vector temp = workspace_vector(W, b->size);
+    LU_solve_col(LU, perm, b->entries, temp.entries);
+    workspace_release(W, mark);
+}
+
+void LU_solve_sparse(const Matrix *LU, const Vector *inv_perm, const SparseMatrix *B,
+        unsigned int col, Vector *x) {
+    if (LU->size_r != x->size || B->size_r != x->size)
+        runtime_error("LU_solve_sparse: incompatible sizes");
+    if (col >= B->size_c)
+        runtime_error("LU_solve_sparse: col index out of range");
+
+    // Scatter the column straight into its permuted position
+    unsigned int k;
+    reset_vector(x);
+    for (k = B->col_start[col]; k < B->col_start[col + 1]; k++)
+        x->entries[(int)inv_perm->entries[B->row_index[k]]] = B->values[k];
+    LU_substitute(LU, x->entries);
+}
+
+void LU_solve_trans(const Matrix *LU, const Vector *perm, Vector *b) {
+    if (LU->size_r != b->size)
+        runtime_error("LU_solve_trans: incompatible sizes");
+
+    double *x = b->entries;
+    double *col;
+    int i, k, n = b->size;
+
+    // Forward substitution with U^t, row k of U^t is column k of U
+    for (k = 0; k < n; k++) {
+        col = COL(LU, k);
+        x[k] = (x[k] - kernel_dot(col, x, k)) / col[k];
+    }
+    // Back-substitution with L^t
+    for (k = n - 1; k >= 0; k--)
+        x[k] -= kernel_dot(COL(LU, k) + k + 1, x + k + 1, n - k - 1);
+
+    // Undo the permutation
+    Vector *temp = copy_vector(b);
+    for (i = 0; i < n; i++)
+        x[(int)perm->entries[i]] = temp->entries[i];
+    free_vector(temp);
+}
+
+// Helper function for householder_QR and QR_decomp - not exported
+// Apply H = I - tau v v^t to the vector c, where v has an implicit 1 at
+// position k and the entries of v below it; only rows k..m-1 are touched.
+void apply_reflector(const double *v, double tau, double *c, int k, int m) {
+    if (tau == 0)
+        return;
+    double w = tau * (c[k] + kernel_dot(v + k + 1, c + k + 1, m - k - 1));
+    c[k] -= w;
+    kernel_axpy(c + k + 1, -w, v + k + 1, m - k - 1);
+}
+
+// Helper function for householder_QR and QR_decomp - not exported
+// Apply H as in apply_reflector to four vectors at once, so v is read only
+// once per pass instead of four times
+void apply_reflector_4(const double *v, double tau, double *c0, double *c1,
+        double *c2, double *c3, int k, int m) {
+    if (tau == 0)
+        return;
+    int i;
+    double w0 = c0[k], w1 = c1[k], w2 = c2[k], w3 = c3[k];
+    double vi;
+    for (i = k + 1; i < m; i++) {
+        vi = v[i];
+        w0 += vi * c0[i];
+        w1 += vi * c1[i];
+        w2 += vi * c2[i];
+        w3 += vi * c3[i];
+    }
+    w0 *= tau; w1 *= tau; w2 *= tau; w3 *= tau;
+    c0[k] -= w0; c1[k] -= w1; c2[k] -= w2; c3[k] -= w3;
+    for (i = k + 1; i < m; i++) {
+        vi = v[i];
+        c0[i] -= w0 * vi;
+        c1[i] -= w1 * vi;
+        c2[i] -= w2 * vi;
+        c3[i] -= w3 * vi;
+    }
+}
+
+// Helper function for householder_QR and QR_decomp - not exported
+// Apply H_first, ..., H_last (in that order, either ascending or descending)
+// stored in the columns of V to the columns j0..j1-1 of C, four at a time
+void apply_reflectors(const Matrix *V, const Vector *tau, int first, int last,
+        Matrix *C, int j0, int j1) {
+    int j, k, step = (first <= last ? 1 : -1);
+    for (j = j0; j + 4 <= j1; j += 4) {
+        for (k = first; k != last + step; k += step)
+            apply_reflector_4(COL(V, k), tau->entries[k], COL(C, j), COL(C, j + 1),
+                    COL(C, j + 2), COL(C, j + 3), k, V->size_r);
+    }
+    for (; j < j1; j++) {
+        for (k = first; k != last + step; k += step)
+            apply_reflector(COL(V, k), tau->entries[k], COL(C, j), k, V->size_r);
+    }
+}
+
+void householder_QR(Matrix *A, Vector *tau) {
+    int m = A->size_r, n = A->size_c;
+    int kmax = (m < n ? m : n);
+    if (tau->size != kmax)
+        runtime_error("householder_QR: tau of wrong size");
+    // Nothing to factor; the panel loops below assume at least one reflector
+    if (kmax == 0)
+        return;
+
+    double *col_k;
+    double alpha, beta, sigma;
+    int i, j, k, k0, kb;
+    for (k0 = 0; k0 < kmax; k0 += QR_BLOCK) {
+        kb = (kmax - k0 < QR_BLOCK ? kmax - k0 : QR_BLOCK);
+
+        // Factor the panel k0..k0+kb-1, updating only its own columns
+        for (k = k0; k < k0 + kb; k++) {
+            col_k = COL(A, k);
+            alpha = col_k[k];
+            sigma = 0;
+            for (i = k + 1; i < m; i++)
+                sigma += col_k[i] * col_k[i];
+
+            // Nothing to eliminate below the diagonal
+            if (sigma == 0) {
+                tau->entries[k] = 0;
+                continue;
+            }
+
+            // beta gets the sign opposite to alpha to avoid cancellation
+            beta = sqrt(alpha * alpha + sigma);
+            if (alpha > 0)
+                beta = -beta;
+            tau->entries[k] = (beta - alpha) / beta;
+            for (i = k + 1; i < m; i++)
+                col_k[i] /= alpha - beta;
+            col_k[k] = beta;
+
+            for (j = k + 1; j < k0 + kb; j++)
+                apply_reflector(col_k, tau->entries[k], COL(A, j), k, m);
+        }
+
+        // Apply all reflectors of the panel to the trailing columns, a few
+        // columns at a time, so those stay in cache while the panel is reused
+        apply_reflectors(A, tau, k0, k0 + kb - 1, A, k0 + kb, n);
+    }
+}
+
 void QR_decomp(const Matrix *A, Matrix *Q, Matrix *R) {
     if (A->size_r != Q->size_r || A->size_c != Q->size_c)
         runtime_error("QR_decomp: A, Q are of unequal size");
-    if (A->size_c != R->size_c || A->size_c != R->size_c)
-        runtime_error("QR_decomp: R of wrong size (should be mxm)");
-    
-    Vector *q = zero_vector(A->size_r);
-    Vector *dummy = zero_vector(A->size_r);
-    unsigned int i; // current column
-    unsigned int j; // current row
-    for (i = 0; i < A->size_c; i++) {
-        copy_col(A, q, i);
-        for (j = 0; j < i; j++) {
-            copy_col(Q, dummy, j);
-            R->entries[j][i] = inner_product(dummy, q); 
-            scalar_to_vector(dummy, R->entries[j][i]);
-            sub_to_vector(q, dummy);
-        }
-        R->entries[i][i] = norm(q);
-        if (!is_zero(R->entries[i][i])) {
-            scalar_to_vector(q, 1. / R->entries[i][i]);
-            replace_col(Q, q, i);
+    if (A->size_c != R->size_r || A->size_c != R->size_c)
+        runtime_error("QR_decomp: R of wrong size (should be nxn)");
+
+    int m = A->size_r, n = A->size_c;
+    int kmax = (m < n ? m : n);
+    Matrix *H = zero_matrix(m, n);
+    Vector *tau = zero_vector(kmax);
+    int i, j, k, k0, k1;
+    for (j = 0; j < n; j++)
+        memcpy(COL(H, j), COL(A, j), m * sizeof(double));
+    householder_QR(H, tau);
+
+    // R is the upper triangle of H
+    for (j = 0; j < n; j++) {
+        memset(COL(R, j), 0, n * sizeof(double));
+        for (i = 0; i <= j && i < m; i++)
+            ENTRY(R, i, j) = ENTRY(H, i, j);
+    }
+
+    // Form Q = H_0 H_1 ... H_(kmax-1) applied to the first n unit vectors,
+    // panel by panel from the last one. H_k leaves e_j alone for k > j.
+    for (j = 0; j < n; j++) {
+        memset(COL(Q, j), 0, m * sizeof(double));
+        if (j < m)
+            ENTRY(Q, j, j) = 1;
+    }
+    // Without reflectors Q is already done, and the first panel would be
+    // empty, with k1 = -1
+    if (kmax == 0) {
+        free_matrix(H);
+        free_vector(tau);
+        return;
+    }
+    for (k0 = (kmax - 1) / QR_BLOCK * QR_BLOCK; k0 >= 0; k0 -= QR_BLOCK) {
+        k1 = (k0 + QR_BLOCK < kmax ? k0 + QR_BLOCK : kmax) - 1;
+        for (j = k0; j < k1; j++) {
+            for (k = j; k >= k0; k--)
+                apply_reflector(COL(H, k), tau->entries[k], COL(Q, j), k, m);
         }
-        else
-            R->entries[i][i] = 0;
+        apply_reflectors(H, tau, k1, k0, Q, k1, n);
+    }
+    free_matrix(H);
+    free_vector(tau);
+}
+
+// Helper function for QR_solve and QR_solve_matrix - not exported
+// Check that the factorized matrix is square and non-singular
+void check_QR(const Matrix *QR, const Vector *tau) {
+    if (QR->size_r != QR->size_c || tau->size != QR->size_c)
+        runtime_error("QR_solve: matrix should be square");
+    unsigned int i;
+    for (i = 0; i < QR->size_c; i++) {
+        if (is_zero(ENTRY(QR, i, i)))
+            runtime_error("QR_solve: matrix singular");
+    }
+}
+
+// Helper function for QR_solve and QR_solve_matrix - not exported
+// Overwrite x by R^-1 x, going through R column by column
+void R_solve(const Matrix *QR, double *x) {
+    double *col;
+    int k;
+    for (k = QR->size_c - 1; k >= 0; k--) {
+        if (x[k] == 0)
+            continue;
+        col = COL(QR, k);
+        x[k] /= col[k];
+        kernel_axpy(x, -x[k], col, k);
     }
-    free_vector(q);
-    free_vector(dummy);
+}
+
+void QR_solve(const Matrix *QR, const Vector *tau, Vector *b) {
+    if (QR->size_r != b->size)
+        runtime_error("QR_solve: incompatible sizes");
+    check_QR(QR, tau);
+
+    // b := Q^t b = H_(n-1) ... H_0 b, then back-substitution
+    unsigned int k;
+    for (k = 0; k < tau->size; k++)
+        apply_reflector(COL(QR, k), tau->entries[k], b->entries, k, QR->size_r);
+    R_solve(QR, b->entries);
+}
+
+void QR_solve_matrix(const Matrix *QR, const Vector *tau, Matrix *B) {
+    if (QR->size_r != B->size_r)
+        runtime_error("QR_solve_matrix: incompatible sizes");
+    check_QR(QR, tau);
+    if (tau->size == 0)
+        return;
+
+    apply_reflectors(QR, tau, 0, tau->size - 1, B, 0, B->size_c);
+    unsigned int j;
+    for (j = 0; j < B->size_c; j++)
+        R_solve(QR, COL(B, j));
 }
 
 int is_zero(double l) {
@@ -142,7 +468,7 @@ int rank_R(const Matrix *R) {
     r = 0;
     // Count number of non-zero diagonal elements of R
     for (i = 0; i < R->size_c; i++)
-        r += (!is_zero(R->entries[i][i]));
+        r += (!is_zero(ENTRY(R, i, i)));
     return r;
 }
 
@@ -156,11 +482,7 @@ double inner_product(const Vector *a, const Vector *b) {
     if (a->size != b->size)
         runtime_error("inner_product: vertices are of unequal size");
 
-    unsigned int i;
-    double res = 0;
-    for (i = 0; i < a->size; i++) 
-        res += a->entries[i] * b->entries[i];
-    return res;
+    return kernel_dot(a->entries, b->entries, a->size);
 }
 
 double norm(const Vector *vector) {
@@ -170,23 +492,50 @@ double norm(const Vector *vector) {
 void copy_col(const Matrix *matrix, Vector *vector, unsigned int col) {
     if (vector->size != matrix->size_r)
         runtime_error("copy_col: vertex and matrix size incompatible");
-    if (matrix->size_c < col)
-        runtime_error("copy_col: col index too high");
+    if (col >= matrix->size_c)
+        runtime_error("copy_col: col index out of range");
 
-    unsigned int i;
-    for (i = 0; i < vector->size; i++)
-        vector->entries[i] = matrix->entries[i][col];    
+    memcpy(vector->entries, COL(matrix, col), vector->size * sizeof(double));
 }
 
 void replace_col(Matrix *matrix, const Vector *vector, unsigned int col) {
     if (vector->size != matrix->size_r)
         runtime_error("replace_col: vertex and matrix size incompatible");
-    if (matrix->size_c < col)
-        runtime_error("replace_col: col index too high");
+    if (col >= matrix->size_c)
+        runtime_error("replace_col: col index out of range");
 
-    unsigned int i;
-    for (i = 0; i < vector->size; i++)
-        matrix->entries[i][col] = vector->entries[i];
+    memcpy(COL(matrix, col), vector->entries, vector->size * sizeof(double));
+}
+
+void copy_row(const Matrix *matrix, Vector *vector, unsigned int row) {
+    if (vector->size != matrix->size_c)
+        runtime_error("copy_row: vertex and matrix size incompatible");
+    if (row >= matrix->size_r)
+        runtime_error("copy_row: row index out of range");
+
+    unsigned int j;
+    for (j = 0; j < vector->size; j++)
+        vector->entries[j] = ENTRY(matrix, row, j);
+}
+
+void replace_row(Matrix *matrix, const Vector *vector, unsigned int row) {
+    if (vector->size != matrix->size_c)
+        runtime_error("replace_row: vertex and matrix size incompatible");
+    if (row >= matrix->size_r)
+        runtime_error("replace_row: row index out of range");
+
+    unsigned int j;
+    for (j = 0; j < vector->size; j++)
+        ENTRY(matrix, row, j) = vector->entries[j];
+}
+
+Vector col_view(const Matrix *matrix, unsigned int col) {
+    if (col >= matrix->size_c)
+        runtime_error("col_view: col index out of range");
+    Vector view;
+    view.size = matrix->size_r;
+    view.entries = COL(matrix, col);
+    return view;
 }
 
 int is_smaller_zero_vect(const Vector *vector) {
@@ -198,64 +547,52 @@ int is_smaller_zero_vect(const Vector *vector) {
     return 1;
 }
 
+// Helper function for subind_vector, subind_matrix and sparse_subind_matrix - not exported
+unsigned int count_nonzero(const Vector *bitmask) {
+    unsigned int i, count = 0;
+    for (i = 0; i < bitmask->size; i++)
+        count += (bitmask->entries[i] != 0);
+    return count;
+}
+
 Vector *subind_vector(const Vector *vector, const Vector *bitmask) {
     if (vector->size != bitmask->size)
         runtime_error("subind_vector: bitmask should be of same size as vector");
-    unsigned int i, count;
-    count = 0;
-    // Set which indices are not zero in bitmask
-    Vector *indices = zero_vector(vector->size);
-    for (i = 0; i < bitmask->size; i++) {
-        if (bitmask->entries[i] != 0) {
-            indices->entries[count] = i;
-            count ++;
-        }
-    }
+    Vector *res = zero_vector(count_nonzero(bitmask));
+    subind_to_vector(vector, bitmask, res);
+    return res;
+}
 
-    // Now create the subvector
-    Vector *res = zero_vector(count);
-    unsigned int j, d;
-    for (j = 0; j < count; j++) {
-        d = (int)indices->entries[j];
-        res->entries[j] = vector->entries[d];
+void subind_to_vector(const Vector *vector, const Vector *bitmask, Vector *ret) {
+    if (vector->size != bitmask->size)
+        runtime_error("subind_to_vector: bitmask should be of same size as vector");
+    if (ret->size != count_nonzero(bitmask))
+        runtime_error("subind_to_vector: ret should have an entry for each entry in bitmask unequal to 0");
+    unsigned int i, count = 0;
+    for (i = 0; i < bitmask->size; i++) {
+        if (bitmask->entries[i] != 0)
+            ret->entries[count++] = vector->entries[i];
     }
-    free_vector(indices);
-    return res;
 }
 
 Matrix *subind_matrix(const Matrix *matrix, const Vector *bitmask) {
     if (matrix->size_c != bitmask->size)
         runtime_error("subind_matrix: bitmask should have an entry for each column of matrix");
-    unsigned int i, count;
-    count = 0;
-    // Set which indices are not zero in bitmask
-    Vector *indices = zero_vector(matrix->size_c);
+    Matrix *res = zero_matrix(matrix->size_r, count_nonzero(bitmask));
+    unsigned int i, count = 0;
     for (i = 0; i < bitmask->size; i++) {
-        if (bitmask->entries[i] != 0) {
-            indices->entries[count] = i;
-            count ++;
-        }
-    }
-
-    // Now create the submatrix
-    Matrix *res = zero_matrix(matrix->size_r, count);
-    unsigned int j, d;
-    for (i = 0; i < matrix->size_r; i++) {
-        for (j = 0; j < count; j++) {
-            d = (int)indices->entries[j];
-            res->entries[i][j] = matrix->entries[i][d];
-        }
+        if (bitmask->entries[i] != 0)
+            memcpy(COL(res, count++), COL(matrix, i), matrix->size_r * sizeof(double));
     }
-    free_vector(indices);
     return res;
 }
 
 Matrix *trans_matrix(const Matrix *matrix) {
     Matrix *res = zero_matrix(matrix->size_c, matrix->size_r);
     unsigned int i, j;
-    for (i = 0; i < matrix->size_r; i++) {
-        for (j = 0; j < matrix->size_c; j++) {
-            res->entries[j][i] = matrix->entries[i][j];
+    for (j = 0; j < matrix->size_c; j++) {
+        for (i = 0; i < matrix->size_r; i++) {
+            ENTRY(res, j, i) = ENTRY(matrix, i, j);
         }    
     }
     return res;
@@ -266,48 +603,63 @@ Matrix *mult_matrix(const Matrix *A, const Matrix *B) {
         runtime_error("mult_matrix: matrices of incompatible sizes");
 
     Matrix *res = zero_matrix(A->size_r, B->size_c);
-    unsigned int i, j, k;
-    for (i = 0; i < A->size_r; i++) {
-        for (j = 0; j < B->size_c; j++) {
-            for (k = 0; k < A->size_c; k++) {
-                res->entries[i][j] += A->entries[i][k] * B->entries[k][j];    
-            }
+    mult_to_matrix(A, B, res);
+    return res;
+}
+
+void mult_to_matrix(const Matrix *A, const Matrix *B, Matrix *res) {
+    if (A->size_c != B->size_r || res->size_r != A->size_r || res->size_c != B->size_c)
+        runtime_error("mult_to_matrix: matrices of incompatible sizes");
+
+    unsigned int j, k, nnz = 0;
+    double b;
+    for (j = 0; j < res->size_c; j++)
+        memset(COL(res, j), 0, res->size_r * sizeof(double));
+    for (j = 0; j < B->size_c; j++) {
+        for (k = 0; k < B->size_r; k++)
+            nnz += (ENTRY(B, k, j) != 0);
+    }
+
+    // Mostly dense B: blocked multiplication
+    if (2 * (double)nnz > (double)B->size_r * B->size_c) {
+        kernel_gemm(A->size_r, B->size_c, A->size_c, A->entries, A->ld,
+                B->entries, B->ld, res->entries, res->ld);
+        return;
+    }
+
+    // Sparse B: column j of AB is a sum of columns of A, weighted by
+    // the non-zero entries of column j of B
+    for (j = 0; j < B->size_c; j++) {
+        for (k = 0; k < A->size_c; k++) {
+            b = ENTRY(B, k, j);
+            if (b != 0)
+                kernel_axpy(COL(res, j), b, COL(A, k), A->size_r);
         }    
     }
-    return res;
 }
 
 void scalar_to_matrix(Matrix *A, const double l) {
-    unsigned int i, j;
-    for (i = 0; i < A->size_r; i++) {
-        for (j = 0; j < A->size_c; j++) {
-            A->entries[i][j] *= l;    
-        }
-    }
+    unsigned int j;
+    for (j = 0; j < A->size_c; j++)
+        kernel_scale(COL(A, j), l, A->size_r);
 }
 
 void add_to_vector(Vector *a, const Vector *b) {
     if (a->size != b->size)
         runtime_error("sub_vector: vertices are of unequal size");
 
-    unsigned int i;
-    for (i = 0; i < a->size; i++)
-        a->entries[i] += b->entries[i];
+    kernel_add(a->entries, b->entries, a->size);
 }
 
 void sub_to_vector(Vector *a, const Vector *b) {
     if (a->size != b->size)
         runtime_error("sub_vector: vertices are of unequal size");
 
-    unsigned int i;
-    for (i = 0; i < a->size; i++)
-        a->entries[i] -= b->entries[i];
+    kernel_sub(a->entries, b->entries, a->size);
 }
 
 void scalar_to_vector(Vector *a, const double l) {
-    unsigned int i;
-    for (i = 0; i < a->size; i++)
-        a->entries[i] *= l;    
+    kernel_scale(a->entries, l, a->size);
 }
 
 Vector *mult_vector(const Matrix *matrix, const Vector *vector) {
@@ -316,24 +668,42 @@ Vector *mult_vector(const Matrix *matrix, const Vector *vector) {
 
     Vector *res = zero_vector(matrix->size_r);
     
-    unsigned int i,j;
-    for (i = 0; i < matrix->size_r; i++) {
-        for (j = 0; j < vector->size; j ++) {
-            res->entries[i] += matrix->entries[i][j] * vector->entries[j];
-        }
+    // Sum the columns of the matrix, weighted by the entries of vector
+    unsigned int j;
+    double v;
+    for (j = 0; j < vector->size; j ++) {
+        v = vector->entries[j];
+        if (v != 0)
+            kernel_axpy(res->entries, v, COL(matrix, j), matrix->size_r);
     }
     return res;
 }
 
+Vector *mult_vector_trans(const Matrix *matrix, const Vector *vector) {
+    if (matrix->size_r != vector->size)
+        runtime_error("mult_vector_trans: vertex and matrix size incompatible");
+
+    Vector *res = zero_vector(matrix->size_c);
+    mult_trans_to_vector(matrix, vector, res);
+    return res;
+}
+
+void mult_trans_to_vector(const Matrix *matrix, const Vector *vector, Vector *ret) {
+    if (matrix->size_r != vector->size || matrix->size_c != ret->size)
+        runtime_error("mult_trans_to_vector: vertex and matrix size incompatible");
+
+    // Entry j is the inner product of column j with vector
+    unsigned int j;
+    for (j = 0; j < matrix->size_c; j++)
+        ret->entries[j] = kernel_dot(COL(matrix, j), vector->entries, vector->size);
+}
+
 Vector *add_vector(const Vector *a, const Vector *b) {
     if (a->size != b->size)
         runtime_error("sub_vector: vertices are of unequal size");
 
-    Vector *res = zero_vector(a->size);
-
-    unsigned int i;
-    for (i = 0; i < a->size; i++)
-        res->entries[i] = a->entries[i] + b->entries[i];
+    Vector *res = copy_vector(a);
+    kernel_add(res->entries, b->entries, a->size);
     return res;
 }
 
@@ -341,11 +711,8 @@ Vector *sub_vector(const Vector *a, const Vector *b) {
     if (a->size != b->size)
         runtime_error("sub_vector: vertices are of unequal size");
 
-    Vector *res = zero_vector(a->size);
-
-    unsigned int i;
-    for (i = 0; i < a->size; i++)
-        res->entries[i] = a->entries[i] - b->entries[i];
+    Vector *res = copy_vector(a);
+    kernel_sub(res->entries, b->entries, a->size);
     return res;
 }
 
@@ -380,23 +747,86 @@ Vector *zero_vector(int size) {
     return res;
 }
 
+// Helper function for zero_matrix and the workspace functions - not exported
+// Round the column length up so that every column is aligned
+unsigned int leading_dimension(int size_r) {
+    const unsigned int per_line = MATRIX_ALIGN / sizeof(double);
+    unsigned int ld = (size_r + per_line - 1) / per_line * per_line;
+    return (ld == 0 ? per_line : ld);
+}
+
 Matrix *zero_matrix(int size_r, int size_c) {
     Matrix *res = calloc(1, sizeof(Matrix));
     res->size_r = size_r;
     res->size_c = size_c;
-    res->entries = calloc(size_r, sizeof(double*));
-    unsigned int i;
-    for (i = 0; i < size_r; i++) 
-        res->entries[i] = calloc(size_c, sizeof(double));
+    res->ld = leading_dimension(size_r);
+
+    size_t bytes = (size_t)res->ld * (size_c > 0 ? size_c : 1) * sizeof(double);
+    void *block;
+    if (posix_memalign(&block, MATRIX_ALIGN, bytes) != 0)
+        runtime_error("zero_matrix: memory allocation failure");
+    memset(block, 0, bytes);
+    res->entries = block;
+    return res;
+}
+
+Workspace *new_workspace(size_t size) {
+    Workspace *W = calloc(1, sizeof(Workspace));
+    W->size = size;
+    void *block;
+    if (posix_memalign(&block, MATRIX_ALIGN, (size > 0 ? size : 1) * sizeof(double)) != 0)
+        runtime_error("new_workspace: memory allocation failure");
+    W->block = block;
+    return W;
+}
+
+size_t workspace_size(int size_r, int size_c) {
+    return (size_t)leading_dimension(size_r) * (size_c > 0 ? size_c : 1);
+}
+
+Vector workspace_vector(Workspace *W, int size) {
+    size_t needed = workspace_size(size, 1);
+    if (W->size - W->used < needed)
+        runtime_error("workspace_vector: workspace too small");
+    Vector res;
+    res.size = size;
+    res.entries = W->block + W->used;
+    memset(res.entries, 0, size * sizeof(double));
+    W->used += needed;
+    return res;
+}
+
+Matrix workspace_matrix(Workspace *W, int size_r, int size_c) {
+    size_t needed = workspace_size(size_r, size_c);
+    if (W->size - W->used < needed)
+        runtime_error("workspace_matrix: workspace too small");
+    Matrix res;
+    res.size_r = size_r;
+    res.size_c = size_c;
+    res.ld = leading_dimension(size_r);
+    res.entries = W->block + W->used;
+    res.rank = 0;
+    memset(res.entries, 0, needed * sizeof(double));
+    W->used += needed;
     return res;
 }
 
+size_t workspace_mark(const Workspace *W) {
+    return W->used;
+}
+
+void workspace_release(Workspace *W, size_t mark) {
+    if (mark > W->used)
+        runtime_error("workspace_release: mark is not in use");
+    W->used = mark;
+}
+
 void print_matrix(const Matrix *matrix) {
     unsigned int i,j;
     for (i = 0; i < matrix->size_r; i++) {
         printf("[");
         for (j = 0; j < matrix->size_c; j++) {
-            printf("%5.2lf%s", matrix->entries[i][j], (j == matrix->size_c-1 ? "]\n" : ", "));
+            printf("%5.2lf%s", ENTRY(matrix, i, j), (j == matrix->size_c-1 ? "]\n" : ", "));
         }
     }
 }
@@ -415,9 +845,236 @@ void free_vector(Vector *vector) {
 }
 
 void free_matrix(Matrix *matrix) {
-    unsigned int i;
-    for (i = 0; i < matrix->size_r; i++)
-        free(matrix->entries[i]);
     free(matrix->entries);
     free(matrix);
+}
+
+SparseMatrix *empty_sparse_matrix(int size_r, int size_c, int nnz) {
+    SparseMatrix *res = calloc(1, sizeof(SparseMatrix));
+    res->size_r = size_r;
+    res->size_c = size_c;
+    res->nnz = nnz;
+    res->col_start = calloc(size_c + 1, sizeof(unsigned int));
+    res->row_index = calloc(nnz > 0 ? nnz : 1, sizeof(unsigned int));
+    res->values = calloc(nnz > 0 ? nnz : 1, sizeof(double));
+    return res;
+}
+
+SparseMatrix *sparse_from_matrix(const Matrix *matrix) {
+    unsigned int i, j, nnz;
+    double *col;
+
+    // Count the non-zero entries first
+    nnz = 0;
+    for (j = 0; j < matrix->size_c; j++) {
+        col = COL(matrix, j);
+        for (i = 0; i < matrix->size_r; i++)
+            nnz += (col[i] != 0);
+    }
+
+    SparseMatrix *res = empty_sparse_matrix(matrix->size_r, matrix->size_c, nnz);
+    nnz = 0;
+    for (j = 0; j < matrix->size_c; j++) {
+        res->col_start[j] = nnz;
+        col = COL(matrix, j);
+        for (i = 0; i < matrix->size_r; i++) {
+            if (col[i] != 0) {
+                res->row_index[nnz] = i;
+                res->values[nnz] = col[i];
+                nnz++;
+            }
+        }
+    }
+    res->col_start[matrix->size_c] = nnz;
+    return res;
+}
+
+Matrix *sparse_to_matrix(const SparseMatrix *matrix) {
+    Matrix *res = zero_matrix(matrix->size_r, matrix->size_c);
+    unsigned int j, k;
+    for (j = 0; j < matrix->size_c; j++) {
+        for (k = matrix->col_start[j]; k < matrix->col_start[j + 1]; k++)
+            ENTRY(res, matrix->row_index[k], j) = matrix->values[k];
+    }
+    return res;
+}
+
+SparseMatrix *sparse_append_identity(const SparseMatrix *A) {
+    SparseMatrix *res = empty_sparse_matrix(A->size_r, A->size_c + A->size_r,
+                                            A->nnz + A->size_r);
+    // Copy entries
+    memcpy(res->col_start, A->col_start, (A->size_c + 1) * sizeof(unsigned int));
+    memcpy(res->row_index, A->row_index, A->nnz * sizeof(unsigned int));
+    memcpy(res->values, A->values, A->nnz * sizeof(double));
+
+    // Add identity entries
+    unsigned int i;
+    for (i = 0; i < A->size_r; i++) {
+        res->row_index[A->nnz + i] = i;
+        res->values[A->nnz + i] = 1;
+        res->col_start[A->size_c + i + 1] = A->nnz + i + 1;
+    }
+    return res;
+}
+
+SparseMatrix *sparse_append_unit_columns(const SparseMatrix *A, const Vector *signs) {
+    if (A->size_r != signs->size)
+        runtime_error("sparse_append_unit_columns: signs should have an entry for each row of A");
+    unsigned int i, count = 0;
+    for (i = 0; i < signs->size; i++)
+        count += (signs->entries[i] != 0);
+
+    SparseMatrix *res = empty_sparse_matrix(A->size_r, A->size_c + count,
+                                            A->nnz + count);
+    // Copy entries
+    memcpy(res->col_start, A->col_start, (A->size_c + 1) * sizeof(unsigned int));
+    memcpy(res->row_index, A->row_index, A->nnz * sizeof(unsigned int));
+    memcpy(res->values, A->values, A->nnz * sizeof(double));
+
+    // Add unit columns
+    count = 0;
+    for (i = 0; i < signs->size; i++) {
+        if (signs->entries[i] == 0)
+            continue;
+        res->row_index[A->nnz + count] = i;
+        res->values[A->nnz + count] = signs->entries[i];
+        res->col_start[A->size_c + count + 1] = A->nnz + count + 1;
+        count++;
+    }
+    return res;
+}
+
+Matrix *sparse_subind_matrix(const SparseMatrix *matrix, const Vector *bitmask) {
+    if (matrix->size_c != bitmask->size)
+        runtime_error("sparse_subind_matrix: bitmask should have an entry for each column of matrix");
+    Matrix *res = zero_matrix(matrix->size_r, count_nonzero(bitmask));
+    sparse_subind_to_matrix(matrix, bitmask, res);
+    return res;
+}
+
+void sparse_subind_to_matrix(const SparseMatrix *matrix, const Vector *bitmask, Matrix *ret) {
+    if (matrix->size_c != bitmask->size)
+        runtime_error("sparse_subind_to_matrix: bitmask should have an entry for each column of matrix");
+    if (ret->size_r != matrix->size_r || ret->size_c != count_nonzero(bitmask))
+        runtime_error("sparse_subind_to_matrix: ret should have a column for each entry in bitmask unequal to 0");
+    unsigned int j, k, count = 0;
+    double *col;
+    for (j = 0; j < bitmask->size; j++) {
+        if (bitmask->entries[j] == 0)
+            continue;
+        col = COL(ret, count);
+        memset(col, 0, ret->size_r * sizeof(double));
+        for (k = matrix->col_start[j]; k < matrix->col_start[j + 1]; k++)
+            col[matrix->row_index[k]] = matrix->values[k];
+        count++;
+    }
+}
+
+void sparse_copy_col(const SparseMatrix *matrix, Vector *vector, unsigned int col) {
+    if (vector->size != matrix->size_r)
+        runtime_error("sparse_copy_col: vertex and matrix size incompatible");
+    if (matrix->size_c <= col)
+        runtime_error("sparse_copy_col: col index too high");
+
+    unsigned int k;
+    reset_vector(vector);
+    for (k = matrix->col_start[col]; k < matrix->col_start[col + 1]; k++)
+        vector->entries[matrix->row_index[k]] = matrix->values[k];
+}
+
+double sparse_col_product(const SparseMatrix *matrix, unsigned int col, const Vector *vector) {
+    if (vector->size != matrix->size_r)
+        runtime_error("sparse_col_product: vertex and matrix size incompatible");
+
+    unsigned int k;
+    double res = 0;
+    for (k = matrix->col_start[col]; k < matrix->col_start[col + 1]; k++)
+        res += matrix->values[k] * vector->entries[matrix->row_index[k]];
+    return res;
+}
+
+Vector *sparse_mult_vector(const SparseMatrix *matrix, const Vector *vector) {
+    if (matrix->size_c != vector->size)
+        runtime_error("sparse_mult_vector: vertex and matrix size incompatible");
+
+    Vector *res = zero_vector(matrix->size_r);
+    unsigned int j, k;
+    double v;
+    for (j = 0; j < matrix->size_c; j++) {
+        v = vector->entries[j];
+        if (v == 0)
+            continue;
+        for (k = matrix->col_start[j]; k < matrix->col_start[j + 1]; k++)
+            res->entries[matrix->row_index[k]] += matrix->values[k] * v;
+    }
+    return res;
+}
+
+void sparse_scale_rows(SparseMatrix *matrix, const Vector *l) {
+    if (matrix->size_r != l->size)
+        runtime_error("sparse_scale_rows: vertex and matrix size incompatible");
+
+    unsigned int k;
+    for (k = 0; k < matrix->nnz; k++)
+        matrix->values[k] *= l->entries[matrix->row_index[k]];
+}
+
+void sparse_scale_columns(SparseMatrix *matrix, const Vector *l) {
+    if (matrix->size_c != l->size)
+        runtime_error("sparse_scale_columns: vertex and matrix size incompatible");
+
+    unsigned int j, k;
+    for (j = 0; j < matrix->size_c; j++) {
+        for (k = matrix->col_start[j]; k < matrix->col_start[j + 1]; k++)
+            matrix->values[k] *= l->entries[j];
+    }
+}
+
+void sparse_subind_rows(SparseMatrix *matrix, const Vector *bitmask) {
+    if (matrix->size_r != bitmask->size)
+        runtime_error("sparse_subind_rows: bitmask should have an entry for each row of matrix");
+
+    // New index of each row that is kept
+    unsigned int *new_row = calloc(matrix->size_r, sizeof(unsigned int));
+    unsigned int i, j, k, count = 0;
+    for (i = 0; i < matrix->size_r; i++) {
+        if (bitmask->entries[i] != 0)
+            new_row[i] = count++;
+    }
+
+    // Move the entries in kept rows to the front, column by column
+    unsigned int nnz = 0, start = 0;
+    for (j = 0; j < matrix->size_c; j++) {
+        for (k = start; k < matrix->col_start[j + 1]; k++) {
+            i = matrix->row_index[k];
+            if (bitmask->entries[i] == 0)
+                continue;
+            matrix->row_index[nnz] = new_row[i];
+            matrix->values[nnz] = matrix->values[k];
+            nnz++;
+        }
+        start = matrix->col_start[j + 1];
+        matrix->col_start[j + 1] = nnz;
+    }
+    matrix->size_r = count;
+    matrix->nnz = nnz;
+    free(new_row);
+}
+
+void print_sparse_matrix(const SparseMatrix *matrix) {
+    Matrix *dense = sparse_to_matrix(matrix);
+    print_matrix(dense);
+    free_matrix(dense);
+}
+
+void free_sparse_matrix(SparseMatrix *matrix) {
+    free(matrix->col_start);
+    free(matrix->row_index);
+    free(matrix->values);
+    free(matrix);
+}
+
+void free_workspace(Workspace *W) {
+    free(W->block);
+    free(W);
 }
\ No newline at end of file
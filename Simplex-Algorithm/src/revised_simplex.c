@@ -0,0 +1,523 @@
+#include "dual_simplex.h"
+
+// Helper function for refactor_revised_basis - not exported
+// Return A_B with its columns in the order of the conversion table
+Matrix *basis_matrix(const RevisedBasis *R) {
+    SparseMatrix *A = R->P->A;
+    Matrix *AB = zero_matrix(A->size_r, R->size_B);
+    unsigned int j, k, col;
+    for (j = 0; j < R->size_B; j++) {
+        col = (int)R->indices_B->entries[j];
+        for (k = A->col_start[col]; k < A->col_start[col + 1]; k++)
+            ENTRY(AB, A->row_index[k], j) = A->values[k];
+    }
+    return AB;
+}
+
+// Helper function for refactor_revised_basis and pivot_revised_basis - not exported
+// Set basic values slightly below zero, as left by rounding and Harris'
+// ratio test, to zero. The dual simplex keeps negative values as they are.
+void clamp_basic_solution(RevisedBasis *R) {
+    int k;
+    if (R->dual)
+        return;
+    for (k = 0; k < R->size_B; k++) {
+        if (R->x_B->entries[k] < -ZERO_TOL)
+            runtime_error("clamp_basic_solution: negative entry in basic solution");
+        if (R->x_B->entries[k] < 0)
+            R->x_B->entries[k] = 0;
+    }
+}
+
+// Helper function for build_revised_basis and build_dual_basis - not exported
+RevisedBasis *new_revised_basis(LP *P, Vector *basis, int dual) {
+    RevisedBasis *R = calloc(1, sizeof(RevisedBasis));
+    R->P = P;
+    R->dual = dual;
+    R->B = copy_vector(basis);
+    R->size = basis->size;
+
+    // Set conversion table
+    unsigned int i;
+    for (i = 0; i < R->size; i++)
+        R->size_B += (R->B->entries[i] != 0);
+    if (R->size_B != P->A->size_r)
+        runtime_error("build_revised_basis: basis of wrong size");
+    R->indices_B = zero_vector(R->size_B);
+    R->size_B = 0;
+    for (i = 0; i < R->size; i++) {
+        if (R->B->entries[i] != 0)
+            R->indices_B->entries[R->size_B++] = i;
+    }
+
+    R->perm = zero_vector(R->size_B);
+    R->x_B = zero_vector(R->size_B);
+    refactor_revised_basis(R);
+    return R;
+}
+
+RevisedBasis *build_revised_basis(LP *P, Vector *basis) {
+    return new_revised_basis(P, basis, 0);
+}
+
+RevisedBasis *build_dual_basis(LP *P, Vector *basis) {
+    return new_revised_basis(P, basis, 1);
+}
+
+void refactor_revised_basis(RevisedBasis *R) {
+    // Empty the eta file
+    int k;
+    for (k = 0; k < R->num_eta; k++)
+        free_vector(R->eta[k]);
+    R->num_eta = 0;
+
+    if (R->LU)
+        free_matrix(R->LU);
+    R->LU = basis_matrix(R);
+    LU_decomp(R->LU, R->perm);
+
+    // Compute the basic solution
+    copy_to_vector(R->P->b, R->x_B);
+    ftran(R, R->x_B);
+    clamp_basic_solution(R);
+}
+
+void ftran(const RevisedBasis *R, Vector *v) {
+    LU_solve(R->LU, R->perm, v);
+
+    // Apply the inverses of the eta matrices, oldest first
+    int i, k, row;
+    double *u;
+    for (k = 0; k < R->num_eta; k++) {
+        u = R->eta[k]->entries;
+        row = R->eta_row[k];
+        if (v->entries[row] == 0)
+            continue;
+        v->entries[row] /= u[row];
+        for (i = 0; i < v->size; i++) {
+            if (i != row)
+                v->entries[i] -= u[i] * v->entries[row];
+        }
+    }
+}
+
+void btran(const RevisedBasis *R, Vector *v) {
+    // Apply the inverses of the transposed eta matrices, newest first
+    int i, k, row;
+    double *u;
+    double val;
+    for (k = R->num_eta - 1; k >= 0; k--) {
+        u = R->eta[k]->entries;
+        row = R->eta_row[k];
+        val = v->entries[row];
+        for (i = 0; i < v->size; i++) {
+            if (i != row)
+                val -= u[i] * v->entries[i];
+        }
+        v->entries[row] = val / u[row];
+    }
+
+    LU_solve_trans(R->LU, R->perm, v);
+}
+
+void pivot_revised_basis(RevisedBasis *R, int alpha, int beta, Vector *u) {
+    double theta = R->x_B->entries[beta] / u->entries[beta];
+    int leaving = (int)R->indices_B->entries[beta];
+
+    // Harris' ratio test may choose a leaving variable slightly below zero,
+    // which must not make the step negative. The dual simplex moves
+    // negative basic values up to zero on purpose.
+    if (!R->dual && theta < 0)
+        theta = 0;
+
+    // Update the basic solution
+    int i;
+    for (i = 0; i < R->size_B; i++)
+        R->x_B->entries[i] -= theta * u->entries[i];
+    R->x_B->entries[beta] = theta;
+    clamp_basic_solution(R);
+
+    // Update bitmask and conversion table
+    R->B->entries[leaving] = 0;
+    R->B->entries[alpha] = 1;
+    R->indices_B->entries[beta] = alpha;
+
+    // Append to the eta file, or start over if it is full
+    R->eta[R->num_eta] = u;
+    R->eta_row[R->num_eta] = beta;
+    R->num_eta++;
+    if (R->num_eta == REFACTOR_FREQ)
+        refactor_revised_basis(R);
+}
+
+void dual_values(const RevisedBasis *R, Vector *y) {
+    unsigned int i;
+    for (i = 0; i < R->size_B; i++)
+        y->entries[i] = R->P->c->entries[(int)R->indices_B->entries[i]];
+    btran(R, y);
+}
+
+double reduced_cost(const RevisedBasis *R, const Vector *y, int j) {
+    if (R->B->entries[j] != 0)
+        return 0;
+    return R->P->c->entries[j] - sparse_col_product(R->P->A, j, y);
+}
+
+// Helper function for revised_solve_LP_basis - not exported
+// Store the reduced costs c_N - (A_N)^t y of all variables in d
+void reduced_costs(const RevisedBasis *R, const Vector *y, Vector *d) {
+    unsigned int j;
+    for (j = 0; j < d->size; j++)
+        d->entries[j] = reduced_cost(R, y, j);
+}
+
+// Helper function for revised_solve_LP_basis - not exported
+// Choose an entering variable using the pivot rule, return -1 if there is none
+int revised_choose_alpha(const RevisedBasis *R, const Vector *d, int pivot_rule) {
+    int j, best = -1;
+    double best_value = 0, cur_value;
+    for (j = 0; j < d->size; j++) {
+        if (d->entries[j] <= ZERO_TOL)
+            continue;
+        if (R->weights)
+            cur_value = d->entries[j] * d->entries[j] / R->weights->entries[j];
+        else
+            cur_value = d->entries[j];
+        if (best == -1)
+            best = j;
+        if ((pivot_rule == LCR || pivot_rule == STEEPEST_EDGE || pivot_rule == DEVEX) &&
+                cur_value > best_value)
+            best = j;
+        if (best == j)
+            best_value = cur_value;
+    }
+    return best;
+}
+
+// Helper function for revised_price - not exported
+// Partial pricing as in choose_alpha_PARTIAL: only the reduced costs of the
+// segments up to the first one with a positive reduced cost are computed
+int revised_price_partial(RevisedBasis *R, const Vector *y) {
+    int n = R->size;
+    int size = (n + PARTIAL_SEGMENTS - 1) / PARTIAL_SEGMENTS;
+    int start = (R->pricing_start < n ? R->pricing_start : 0);
+    int j, end, segment, best = -1;
+    double best_value = ZERO_TOL, cur_value;
+    for (segment = 0; segment < PARTIAL_SEGMENTS && best == -1; segment++) {
+        end = (start + size < n ? start + size : n);
+        for (j = start; j < end; j++) {
+            cur_value = reduced_cost(R, y, j);
+            if (cur_value > best_value) {
+                best = j;
+                best_value = cur_value;
+            }
+        }
+        start = (end == n ? 0 : end);
+    }
+    R->pricing_start = start;
+    return best;
+}
+
+// Helper function for revised_price - not exported
+// Multiple pricing as in choose_alpha_MULTIPLE: only the reduced costs of
+// the candidates are computed, until none of them is attractive anymore
+int revised_price_multiple(RevisedBasis *R, const Vector *y, Vector *d) {
+    double values[MULTIPLE_PRICING];
+    double best_value = ZERO_TOL, cur_value;
+    int i, j, best = -1;
+    for (i = 0; i < R->num_candidates; i++) {
+        cur_value = reduced_cost(R, y, R->candidates[i]);
+        if (cur_value > best_value) {
+            best = R->candidates[i];
+            best_value = cur_value;
+        }
+    }
+    if (best != -1)
+        return best;
+
+    reduced_costs(R, y, d);
+    R->num_candidates = 0;
+    for (j = 0; j < d->size; j++) {
+        if (d->entries[j] > ZERO_TOL)
+            insert_candidate(R->candidates, values, &R->num_candidates, j, d->entries[j]);
+    }
+    return (R->num_candidates > 0 ? R->candidates[0] : -1);
+}
+
+// Helper function for revised_solve_LP_basis - not exported
+// Choose an entering variable using the pivot rule, given the dual values
+// y, return -1 if there is none. d is used to store reduced costs.
+int revised_price(RevisedBasis *R, const Vector *y, Vector *d, int pivot_rule) {
+    switch (pivot_rule) {
+        case PARTIAL:
+            return revised_price_partial(R, y);
+        case MULTIPLE:
+            return revised_price_multiple(R, y, d);
+        default:
+            reduced_costs(R, y, d);
+            return revised_choose_alpha(R, d, pivot_rule);
+    }
+}
+
+Vector *entering_column(const RevisedBasis *R, int alpha) {
+    Vector *u = zero_vector(R->size_B);
+    sparse_copy_col(R->P->A, u, alpha);
+    ftran(R, u);
+    return u;
+}
+
+// Helper function for revised_solve_LP_basis - not exported
+// Set the reference weights of the pivot rule as in init_weights. For
+// steepest-edge this takes an ftran for every non-basic variable.
+void revised_init_weights(RevisedBasis *R, int pivot_rule) {
+    if (pivot_rule != STEEPEST_EDGE && pivot_rule != DEVEX)
+        return;
+    R->weights = zero_vector(R->size);
+    Vector *u;
+    int j;
+    for (j = 0; j < R->size; j++) {
+        R->weights->entries[j] = 1;
+        if (pivot_rule == STEEPEST_EDGE && R->B->entries[j] == 0) {
+            u = entering_column(R, j);
+            R->weights->entries[j] += kernel_dot(u->entries, u->entries, u->size);
+            free_vector(u);
+        }
+    }
+}
+
+// Helper function for revised_solve_LP_basis - not exported
+// Update the reference weights for the entering variable alpha with
+// u = (A_B)^-1 a_alpha and the basis position beta, as in update_weights.
+// The pivot row is rho^t A for rho = ((A_B)^t)^-1 e_beta, and the inner
+// products of the edges with u are the entries of A^t ((A_B)^t)^-1 u.
+void revised_update_weights(const RevisedBasis *R, int pivot_rule, int alpha,
+        int beta, const Vector *u) {
+    if (!R->weights)
+        return;
+    SparseMatrix *A = R->P->A;
+    double *w = R->weights->entries;
+    double piv = u->entries[beta];
+    double w_q = w[alpha];
+    double t, cur_value, lower;
+    int j, leaving = (int)R->indices_B->entries[beta];
+
+    Vector *rho = zero_vector(R->size_B);
+    rho->entries[beta] = 1;
+    btran(R, rho);
+    Vector *v = NULL;
+    if (pivot_rule == STEEPEST_EDGE) {
+        v = copy_vector(u);
+        btran(R, v);
+    }
+
+    for (j = 0; j < R->size; j++) {
+        if (R->B->entries[j] != 0 || j == alpha)
+            continue;
+        t = sparse_col_product(A, j, rho) / piv;
+        if (t == 0)
+            continue;
+        if (pivot_rule == DEVEX) {
+            if (t * t * w_q > w[j])
+                w[j] = t * t * w_q;
+            continue;
+        }
+        cur_value = w[j] - 2 * t * sparse_col_product(A, j, v) + t * t * w_q;
+        lower = 1 + t * t;
+        w[j] = (cur_value > lower ? cur_value : lower);
+    }
+    w[leaving] = w_q / (piv * piv);
+    if (w[leaving] < 1)
+        w[leaving] = 1;
+    if (pivot_rule == DEVEX && w[leaving] > DEVEX_RESET) {
+        for (j = 0; j < R->size; j++)
+            w[j] = 1;
+    }
+
+    free_vector(rho);
+    if (v)
+        free_vector(v);
+}
+
+int revised_solve_LP_basis(LP *P, Vector *basis, int pivot_rule, Vector *ret) {
+    RevisedBasis *R = build_revised_basis(P, basis);
+    Vector *d = zero_vector(R->size);
+    Vector *y = zero_vector(R->size_B);
+    Vector *u;
+    int alpha, beta;
+    revised_init_weights(R, pivot_rule);
+
+    // Keep pivoting until no reduced cost is positive
+    int stalled = 0, may_perturb = 1;
+    Vector *orig_b = NULL, *orig_basis = NULL;
+    while (1) {
+        if (may_perturb && stalled >= STALL_LIMIT) {
+            if (!orig_b) {
+                orig_b = copy_vector(P->b);
+                orig_basis = copy_vector(R->B);
+            }
+            perturb_basic_solution(P, R->x_B, R->indices_B);
+            stalled = 0;
+        }
+        dual_values(R, y);
+        alpha = revised_price(R, y, d, pivot_rule);
+        if (alpha == -1 && orig_b) {
+            // Go back to the original b, and finish with the dual simplex if
+            // the basis is no longer primal feasible, as in
+            // simplex_solve_LP_basis
+            copy_to_vector(orig_b, P->b);
+            free_vector(orig_b);
+            orig_b = NULL;
+            if (check_basis(P, R->B) == BASIS_INFEASIBLE) {
+                copy_to_vector(R->B, basis);
+                if (dual_solve_LP_basis(P, basis, ret) == 0) {
+                    free_vector(orig_basis);
+                    free_vector(d);
+                    free_vector(y);
+                    free_revised_basis(R);
+                    return 0;
+                }
+                free_revised_basis(R);
+                R = build_revised_basis(P, orig_basis);
+                revised_init_weights(R, pivot_rule);
+                may_perturb = 0;
+            }
+            else
+                refactor_revised_basis(R);
+            free_vector(orig_basis);
+            orig_basis = NULL;
+            continue;
+        }
+        if (alpha == -1)
+            break;
+
+        u = entering_column(R, alpha);
+        beta = ratio_test(R->x_B, u, R->indices_B);
+
+        // LP unbounded
+        if (beta == -1) {
+            if (orig_b) {
+                copy_to_vector(orig_b, P->b);
+                free_vector(orig_b);
+                free_vector(orig_basis);
+            }
+            free_vector(u);
+            free_vector(d);
+            free_vector(y);
+            copy_to_vector(R->B, basis);
+            free_revised_basis(R);
+            return 1;
+        }
+        count_pivot(R->x_B->entries[beta] <= simplex_params.harris_tol, &stalled);
+        revised_update_weights(R, pivot_rule, alpha, beta, u);
+        pivot_revised_basis(R, alpha, beta, u);
+    }
+
+    // Store the basic solution
+    unsigned int i;
+    reset_vector(ret);
+    for (i = 0; i < R->size_B; i++)
+        ret->entries[(int)R->indices_B->entries[i]] = R->x_B->entries[i];
+    copy_to_vector(R->B, basis);
+
+    free_vector(d);
+    free_vector(y);
+    free_revised_basis(R);
+    return 0;
+}
+
+// Helper function for revised_solve_LP - not exported
+// Pivot artificial variables (those with index >= size) that are still basic
+// after phase one out of the basis, as in drive_out_artificials
+void revised_drive_out_artificials(LP *I, Vector *basis, int size) {
+    RevisedBasis *R = build_revised_basis(I, basis);
+    Vector *rho = zero_vector(R->size_B);
+    int alpha, beta;
+    for (beta = 0; beta < R->size_B; beta++) {
+        if (R->indices_B->entries[beta] < size)
+            continue;
+
+        // Row beta of (A_B)^-1 A
+        reset_vector(rho);
+        rho->entries[beta] = 1;
+        btran(R, rho);
+        int best = -1;
+        double max = PIVOT_TOL;
+        for (alpha = 0; alpha < size; alpha++) {
+            if (R->B->entries[alpha] != 0)
+                continue;
+            double entry = fabs(sparse_col_product(I->A, alpha, rho));
+            if (entry > max) {
+                max = entry;
+                best = alpha;
+            }
+        }
+        if (best != -1)
+            pivot_revised_basis(R, best, beta, entering_column(R, best));
+    }
+    copy_to_vector(R->B, basis);
+    free_vector(rho);
+    free_revised_basis(R);
+}
+
+int revised_solve_LP(LP *P, int pivot_rule, Vector *ret) {
+    Vector *basis = zero_vector(P->A->size_c);
+    int result = revised_solve_LP_final_basis(P, pivot_rule, basis, ret);
+    free_vector(basis);
+    return result;
+}
+
+int revised_solve_LP_final_basis(LP *P, int pivot_rule, Vector *final_basis, Vector *ret) {
+
+    // Check m <= n
+    if (P->A->size_r > P->A->size_c)
+        return WRONG_FORM;
+
+    // Phase one: find an initial basis using the artificial LP I
+    // which is skipped if the crash basis is feasible
+    Vector *basis;
+    LP *I = initial_basis_LP(P, &basis);
+    unsigned int i;
+    memset(&simplex_stats, 0, sizeof(SimplexStats));
+    if (I->A->size_c > P->A->size_c) {
+        Vector *sol = zero_vector(I->A->size_c);
+        revised_solve_LP_basis(I, basis, pivot_rule, sol);
+        simplex_stats.phase_one_pivots = simplex_stats.pivots;
+
+        // System infeasible
+        if (inner_product(I->c, sol) < -ZERO_TOL) {
+            free_LP(I);
+            free_vector(basis);
+            free_vector(sol);
+            return INFEASIBLE;
+        }
+        free_vector(sol);
+        revised_drive_out_artificials(I, basis, P->A->size_c);
+        remove_redundant_rows(P, I, basis);
+    }
+    free_LP(I);
+
+    // Phase two: solve the LP and return whether it is bounded
+    Vector *init_basis = zero_vector(P->A->size_c);
+    for (i = 0; i < init_basis->size; i++)
+        init_basis->entries[i] = basis->entries[i];
+    free_vector(basis);
+
+    int result = revised_solve_LP_basis(P, init_basis, pivot_rule, ret);
+    copy_to_vector(init_basis, final_basis);
+    free_vector(init_basis);
+    return (result == 0 ? SOLVABLE : UNBOUNDED);
+}
+
+void free_revised_basis(RevisedBasis *R) {
+    int k;
+    for (k = 0; k < R->num_eta; k++)
+        free_vector(R->eta[k]);
+    free_vector(R->B);
+    free_vector(R->indices_B);
+    free_vector(R->x_B);
+    free_vector(R->perm);
+    free_matrix(R->LU);
+    if (R->weights)
+        free_vector(R->weights);
+    free(R);
+}
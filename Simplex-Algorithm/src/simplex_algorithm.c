@@ -1,4 +1,7 @@
-#include "simplex_algorithm.h"
+#include "dual_simplex.h"
+
+SimplexParams simplex_params = {RATIO_STANDARD, HARRIS_TOL, 0};
+SimplexStats simplex_stats;
 
 int choose_alpha(Tableaux *T, int pivot_rule) {
     switch (pivot_rule) {
@@ -8,56 +11,277 @@ int choose_alpha(Tableaux *T, int pivot_rule) {
         case LCR:
             return choose_alpha_LCR(T);
             break;
+        case STEEPEST_EDGE:
+        case DEVEX:
+            return choose_alpha_weighted(T);
+            break;
+        case PARTIAL:
+            return choose_alpha_PARTIAL(T);
+            break;
+        case MULTIPLE:
+            return choose_alpha_MULTIPLE(T);
+            break;
         default:
             return choose_alpha_BLAND(T);
     }
 }
 
+// Since pivot_tableaux does not keep the conversion tables sorted,
+// ties are broken on the real indices of the variables
+
 int choose_alpha_BLAND(Tableaux *T) {
     int alpha;
+    int best_alpha = -1;
     for (alpha = 0; alpha < T->r->size; alpha++) {
-        if (T->r->entries[alpha] > 0)
-            return alpha;
+        if (T->r->entries[alpha] > ZERO_TOL && (best_alpha == -1 ||
+                T->indices_N->entries[alpha] < T->indices_N->entries[best_alpha]))
+            best_alpha = alpha;
     }
+    if (best_alpha != -1)
+        return best_alpha;
     runtime_error("choose_alpha_SC: no valid alpha could be found");
     return -1;
 }
 
 int choose_alpha_LCR(Tableaux *T) {
     int alpha;
-    int best_alpha;
-    double largest_coef = -1;
+    int best_alpha = -1;
+    double largest_coef = 0;
     for (alpha = 0; alpha < T->r->size; alpha++) {
-        if (T->r->entries[alpha] > largest_coef) {
+        if (T->r->entries[alpha] > largest_coef || (best_alpha != -1 &&
+                T->r->entries[alpha] == largest_coef &&
+                T->indices_N->entries[alpha] < T->indices_N->entries[best_alpha])) {
             best_alpha = alpha;
             largest_coef = T->r->entries[alpha];
         }
     }
-    if (largest_coef > 0) 
+    if (best_alpha != -1)
         return best_alpha;
     runtime_error("choose_alpha_SC: no valid alpha could be found");
     return -1;
 }
 
+int choose_alpha_weighted(Tableaux *T) {
+    int alpha;
+    int best_alpha = -1;
+    double best_value = 0, cur_value, r;
+    for (alpha = 0; alpha < T->r->size; alpha++) {
+        r = T->r->entries[alpha];
+        if (r <= ZERO_TOL)
+            continue;
+        cur_value = r * r / T->weights->entries[(int)T->indices_N->entries[alpha]];
+        if (best_alpha == -1 || cur_value > best_value || (cur_value == best_value &&
+                T->indices_N->entries[alpha] < T->indices_N->entries[best_alpha])) {
+            best_alpha = alpha;
+            best_value = cur_value;
+        }
+    }
+    if (best_alpha != -1)
+        return best_alpha;
+    runtime_error("choose_alpha_weighted: no valid alpha could be found");
+    return -1;
+}
+
+int choose_alpha_PARTIAL(Tableaux *T) {
+    int n = T->r->size;
+    int size = (n + PARTIAL_SEGMENTS - 1) / PARTIAL_SEGMENTS;
+    int start = (T->pricing_start < n ? T->pricing_start : 0);
+    int alpha, end, segment;
+    int best_alpha = -1;
+    double largest_coef = ZERO_TOL;
+    for (segment = 0; segment < PARTIAL_SEGMENTS && best_alpha == -1; segment++) {
+        end = (start + size < n ? start + size : n);
+        for (alpha = start; alpha < end; alpha++) {
+            if (T->r->entries[alpha] > largest_coef || (best_alpha != -1 &&
+                    T->r->entries[alpha] == largest_coef &&
+                    T->indices_N->entries[alpha] < T->indices_N->entries[best_alpha])) {
+                best_alpha = alpha;
+                largest_coef = T->r->entries[alpha];
+            }
+        }
+        start = (end == n ? 0 : end);
+    }
+    T->pricing_start = start;
+    if (best_alpha != -1)
+        return best_alpha;
+    runtime_error("choose_alpha_PARTIAL: no valid alpha could be found");
+    return -1;
+}
+
+void insert_candidate(int *candidates, double *values, int *num, int index, double value) {
+    int i;
+    if (*num == MULTIPLE_PRICING && value <= values[*num - 1])
+        return;
+    if (*num < MULTIPLE_PRICING)
+        (*num)++;
+    for (i = *num - 1; i > 0 && values[i - 1] < value; i--) {
+        candidates[i] = candidates[i - 1];
+        values[i] = values[i - 1];
+    }
+    candidates[i] = index;
+    values[i] = value;
+}
+
+int choose_alpha_MULTIPLE(Tableaux *T) {
+    int i, alpha;
+    int best_alpha = -1;
+    double values[MULTIPLE_PRICING];
+
+    // Positions whose variable left the basis since have a negative
+    // coefficient, so only attractive candidates are picked
+    for (i = 0; i < T->num_candidates; i++) {
+        alpha = T->candidates[i];
+        if (T->r->entries[alpha] > ZERO_TOL && (best_alpha == -1 ||
+                T->r->entries[alpha] > T->r->entries[best_alpha]))
+            best_alpha = alpha;
+    }
+    if (best_alpha != -1)
+        return best_alpha;
+
+    // Price all of r and keep the best candidates
+    T->num_candidates = 0;
+    for (alpha = 0; alpha < T->r->size; alpha++) {
+        if (T->r->entries[alpha] > ZERO_TOL)
+            insert_candidate(T->candidates, values, &T->num_candidates,
+                    alpha, T->r->entries[alpha]);
+    }
+    if (T->num_candidates > 0)
+        return T->candidates[0];
+    runtime_error("choose_alpha_MULTIPLE: no valid alpha could be found");
+    return -1;
+}
+
+void init_weights(Tableaux *T, int pivot_rule) {
+    if (pivot_rule != STEEPEST_EDGE && pivot_rule != DEVEX)
+        return;
+    if (!T->weights)
+        T->weights = zero_vector(T->size);
+    int i, j;
+    for (i = 0; i < T->size; i++)
+        T->weights->entries[i] = 1;
+    if (pivot_rule == DEVEX)
+        return;
+
+    // The column of Q belonging to a non-basic variable is minus its edge
+    double *col;
+    for (j = 0; j < T->size_N; j++) {
+        col = COL(T->Q, j);
+        T->weights->entries[(int)T->indices_N->entries[j]] += kernel_dot(col, col, T->size_B);
+    }
+}
+
+// Let q be the entering variable and, for each non-basic variable j, let
+// a_j = (A_B)^-1 A_j and t_j = (a_j)_beta / (a_q)_beta. After the pivot,
+// the edge of j is a_j - t_j a_q and the leaving variable p gets weight
+// w_q / ((a_q)_beta)^2. For steepest-edge this gives the exact update
+//   w_j := w_j - 2 t_j (a_j^t a_q) + t_j^2 w_q,
+// which is kept above its lower bound 1 + t_j^2 against rounding errors.
+// Devex only keeps the larger of w_j and t_j^2 w_q.
+void update_weights(Tableaux *T, int pivot_rule, int alpha, int beta) {
+    if (pivot_rule != STEEPEST_EDGE && pivot_rule != DEVEX)
+        return;
+    Matrix *Q = T->Q;
+    double *w = T->weights->entries;
+    double piv = ENTRY(Q, beta, alpha);
+    double w_q = w[(int)T->indices_N->entries[alpha]];
+    double t, cur_value, lower;
+    int i, j, real_index;
+
+    for (j = 0; j < T->size_N; j++) {
+        t = ENTRY(Q, beta, j) / piv;
+        if (j == alpha || t == 0)
+            continue;
+        real_index = (int)T->indices_N->entries[j];
+        if (pivot_rule == DEVEX) {
+            if (t * t * w_q > w[real_index])
+                w[real_index] = t * t * w_q;
+            continue;
+        }
+        cur_value = w[real_index] - 2 * t * kernel_dot(COL(Q, j), COL(Q, alpha), T->size_B)
+            + t * t * w_q;
+        lower = 1 + t * t;
+        w[real_index] = (cur_value > lower ? cur_value : lower);
+    }
+    real_index = (int)T->indices_B->entries[beta];
+    w[real_index] = w_q / (piv * piv);
+    if (w[real_index] < 1)
+        w[real_index] = 1;
+
+    // Start a new reference framework once Devex weights grow too large
+    if (pivot_rule == DEVEX && w[real_index] > DEVEX_RESET) {
+        for (i = 0; i < T->size; i++)
+            w[i] = 1;
+    }
+}
+
 int choose_beta(Tableaux *T, int alpha) {
-    int i, best_beta, best_set;
-    double best_value, cur_value;
-
-    best_set = 0;
-    for (i = 0; i < T->Q->size_r; i++) {
-        if (T->Q->entries[i][alpha] < -ZERO_TOL) {
-            cur_value = T->p->entries[i] / T->Q->entries[i][alpha];
-            if (cur_value > best_value || !best_set) {
-                best_beta = i;
-                best_value = cur_value;
-                best_set = 1;
+    // The column of Q belonging to alpha is minus the direction of x_B
+    size_t mark = workspace_mark(T->W);
+    Vector u = workspace_vector(T->W, T->size_B);
+    copy_col(T->Q, &u, alpha);
+    scalar_to_vector(&u, -1);
+    int beta = ratio_test(T->p, &u, T->indices_B);
+    workspace_release(T->W, mark);
+    return beta;
+}
+
+int ratio_test(const Vector *x, const Vector *u, const Vector *indices_B) {
+    int i, best = -1, blocked = 0;
+    double max_step = -1, cur_value, x_i, piv_tol = 0;
+    double tol = simplex_params.harris_tol;
+
+    // Entries of u count as zero relative to the largest one, so that small
+    // but genuine entries still block when x_i is (close to) zero
+    for (i = 0; i < u->size; i++) {
+        if (fabs(u->entries[i]) > piv_tol)
+            piv_tol = fabs(u->entries[i]);
+    }
+    piv_tol *= PIVOT_TOL;
+
+    if (simplex_params.ratio_test == RATIO_STANDARD) {
+        for (i = 0; i < u->size; i++) {
+            if (u->entries[i] <= piv_tol)
+                continue;
+            x_i = (x->entries[i] > 0 ? x->entries[i] : 0);
+            cur_value = x_i / u->entries[i];
+            if (best == -1 || cur_value < max_step || (cur_value == max_step &&
+                    indices_B->entries[i] < indices_B->entries[best])) {
+                best = i;
+                max_step = cur_value;
             }
         }
+        return best;
+    }
+
+    // First pass: the largest step that keeps x >= -tol. Values below tol
+    // count as zero, so that steps of the size of the tolerance do not
+    // pass for progress.
+    for (i = 0; i < u->size; i++) {
+        if (u->entries[i] <= piv_tol)
+            continue;
+        x_i = (x->entries[i] > tol ? x->entries[i] : 0);
+        cur_value = (x_i + tol) / u->entries[i];
+        if (max_step < 0 || cur_value < max_step)
+            max_step = cur_value;
+        blocked |= (x_i == 0);
     }
-    if (best_set == 1)
-        return best_beta;
-    else
+    if (max_step < 0)
         return -1;
+
+    // Second pass: the largest pivot among those blocking before max_step
+    for (i = 0; i < u->size; i++) {
+        if (u->entries[i] <= piv_tol)
+            continue;
+        x_i = (x->entries[i] > tol ? x->entries[i] : 0);
+        if (x_i / u->entries[i] > max_step)
+            continue;
+        if (best == -1 || u->entries[i] > u->entries[best] || (u->entries[i] == u->entries[best] &&
+                indices_B->entries[i] < indices_B->entries[best]))
+            best = i;
+    }
+    if (blocked && x->entries[best] > tol)
+        simplex_stats.avoided_degenerate++;
+    return best;
 }
 
 void swap_basis(Vector* B, const Tableaux *T, int alpha, int beta) {
@@ -65,23 +289,96 @@ void swap_basis(Vector* B, const Tableaux *T, int alpha, int beta) {
     B->entries[(int)T->indices_B->entries[beta]] = 0;
 }
 
+void count_pivot(int degenerate, int *stalled) {
+    simplex_stats.pivots++;
+    if (!degenerate) {
+        *stalled = 0;
+        return;
+    }
+    simplex_stats.degenerate_pivots++;
+    if (simplex_params.perturb)
+        (*stalled)++;
+}
+
+void perturb_basic_solution(LP *P, Vector *x, const Vector *indices_B) {
+    SparseMatrix *A = P->A;
+    unsigned int k;
+    int i, col;
+    double delta;
+    for (i = 0; i < x->size; i++) {
+        if (x->entries[i] > simplex_params.harris_tol)
+            continue;
+        delta = PERTURBATION * (1 + (double)((i * 7919) % 997) / 997);
+        x->entries[i] += delta;
+
+        // b += delta a_i for the column a_i of the basic variable
+        col = (int)indices_B->entries[i];
+        for (k = A->col_start[col]; k < A->col_start[col + 1]; k++)
+            P->b->entries[A->row_index[k]] += delta * A->values[k];
+    }
+    simplex_stats.perturbations++;
+}
+
 int simplex_solve_LP_basis(LP *P, Vector *basis, int pivot_rule, Vector *ret) {
 
     // Compute an initial simplex-tableaux
     Tableaux *T = build_tableaux(P, basis);
+    init_weights(T, pivot_rule);
 
     // Keep swapping basis elements according to the pivot rule until r <= 0
-    while (!is_smaller_zero_vect(T->r)) {
+    int stalled = 0, may_perturb = 1;
+    Vector *orig_b = NULL, *orig_basis = NULL;
+    while (1) {
+        if (is_smaller_zero_vect(T->r)) {
+            if (!orig_b)
+                break;
+            // Go back to the original b. The basis stays dual feasible, so if
+            // it is no longer primal feasible, the dual simplex finishes from
+            // it. Should that fail, the primal simplex goes on from the basis
+            // it perturbed, without perturbing again.
+            copy_to_vector(orig_b, P->b);
+            free_vector(orig_b);
+            orig_b = NULL;
+            if (check_basis(P, basis) == BASIS_INFEASIBLE) {
+                if (dual_solve_LP_basis(P, basis, ret) == 0) {
+                    free_vector(orig_basis);
+                    free_tableaux(T);
+                    return 0;
+                }
+                copy_to_vector(orig_basis, basis);
+                may_perturb = 0;
+            }
+            free_vector(orig_basis);
+            orig_basis = NULL;
+            set_tableaux(T, basis);
+            init_weights(T, pivot_rule);
+            continue;
+        }
+        if (may_perturb && stalled >= STALL_LIMIT) {
+            if (!orig_b) {
+                orig_b = copy_vector(P->b);
+                orig_basis = copy_vector(basis);
+            }
+            perturb_basic_solution(P, T->p, T->indices_B);
+            stalled = 0;
+        }
         int alpha = choose_alpha(T, pivot_rule);
         int beta = choose_beta(T, alpha);
         
         // LP unbounded
         if (beta == -1) {
+            if (orig_b) {
+                copy_to_vector(orig_b, P->b);
+                free_vector(orig_b);
+                free_vector(orig_basis);
+            }
             free_tableaux(T);
             return 1;
         }
+        count_pivot(T->p->entries[beta] <= simplex_params.harris_tol, &stalled);
+        update_weights(T, pivot_rule, alpha, beta);
         swap_basis(basis, T, alpha, beta);
-        set_tableaux(T, basis);
+        pivot_tableaux(T, basis, alpha, beta);
     }
 
     copy_to_vector(T->x, ret);
@@ -89,23 +386,86 @@ int simplex_solve_LP_basis(LP *P, Vector *basis, int pivot_rule, Vector *ret) {
     return 0;
 }
 
-// This should maybe be modularized
-LP *initial_basis_LP(LP *P) {
-    // Set a new A equal to (A | Im)
-    Matrix *new_A = zero_matrix(P->A->size_r, P->A->size_c + P->A->size_r);
-    unsigned int i, j;
-    // Copy entries
-    for (i = 0; i < P->A->size_r; i++) {
-        for (j = 0; j < P->A->size_c; j++) {
-            new_A->entries[i][j] = P->A->entries[i][j];
+// Helper function for crash_basis - not exported
+// Return the row in which column j of A can enter the crash basis, or -1
+// if it has an entry in a covered row (signs_i = 0). The pivot is the
+// largest entry of at least CRASH_TOL times the largest of the column for
+// which the variable gets a nonnegative value r_i / a_ij.
+int crash_pivot_row(const SparseMatrix *A, int j, const Vector *r, const Vector *signs) {
+    unsigned int k;
+    double max = 0, best = 0;
+    int row = -1;
+    for (k = A->col_start[j]; k < A->col_start[j + 1]; k++)
+        max = fmax(max, fabs(A->values[k]));
+    for (k = A->col_start[j]; k < A->col_start[j + 1]; k++) {
+        unsigned int i = A->row_index[k];
+        double a = A->values[k];
+        if (signs->entries[i] == 0) {
+            if (a != 0)
+                return -1;
+            continue;
+        }
+        if (fabs(a) < CRASH_TOL * max || fabs(a) <= best || r->entries[i] * a < 0)
+            continue;
+        row = i;
+        best = fabs(a);
+    }
+    return row;
+}
+
+int crash_basis(LP *P, Vector *basis, Vector *signs) {
+    SparseMatrix *A = P->A;
+    Vector *r = copy_vector(P->b);
+    unsigned int i, j, k, pass;
+    int row, uncovered = A->size_r;
+    for (i = 0; i < signs->size; i++)
+        signs->entries[i] = 1;
+
+    // Take singleton columns such as slack variables first
+    for (pass = 0; pass < 2 && uncovered > 0; pass++) {
+        for (j = 0; j < A->size_c && uncovered > 0; j++) {
+            if ((A->col_start[j + 1] - A->col_start[j] == 1) != (pass == 0))
+                continue;
+            row = crash_pivot_row(A, j, r, signs);
+            if (row == -1)
+                continue;
+
+            // r -= x_j a_j, which leaves r_row = 0
+            double x = 0;
+            for (k = A->col_start[j]; k < A->col_start[j + 1]; k++) {
+                if (A->row_index[k] == row)
+                    x = r->entries[row] / A->values[k];
+            }
+            for (k = A->col_start[j]; k < A->col_start[j + 1]; k++)
+                r->entries[A->row_index[k]] -= x * A->values[k];
+            r->entries[row] = 0;
+            signs->entries[row] = 0;
+            basis->entries[j] = 1;
+            uncovered--;
         }
     }
-    // Add identity entries
-    for (i = 0; i < P->A->size_r; i++)
-        new_A->entries[i][P->A->size_c + i] = 1;
+
+    // The artificial variables take the remaining r_i
+    for (i = 0; i < signs->size; i++) {
+        if (signs->entries[i] != 0 && r->entries[i] < 0)
+            signs->entries[i] = -1;
+    }
+    free_vector(r);
+    return uncovered;
+}
+
+LP *initial_basis_LP(LP *P, Vector **basis) {
+    Vector *crash = zero_vector(P->A->size_c);
+    Vector *signs = zero_vector(P->A->size_r);
+    int uncovered = crash_basis(P, crash, signs);
+    unsigned int i;
+
+    // Set a new A equal to (A | signs_i e_i for the uncovered rows i)
+    SparseMatrix *new_A = sparse_append_unit_columns(P->A, signs);
+    free_vector(signs);
 
     // Set a new c equal to (0, 0, ... , 0, -1, ... , -1)
-    Vector *new_c = zero_vector(P->c->size + P->A->size_r);
+    Vector *new_c = zero_vector(P->c->size + uncovered);
     for (i = P->A->size_c; i < new_c->size; i++)
         new_c->entries[i] = -1;
 
@@ -114,40 +474,191 @@ LP *initial_basis_LP(LP *P) {
     new_LP->c = new_c;
     new_LP->b = copy_vector(P->b);
 
+    // The crash basis and the artificial variables form the initial basis
+    *basis = zero_vector(new_A->size_c);
+    for (i = 0; i < crash->size; i++)
+        (*basis)->entries[i] = crash->entries[i];
+    for (; i < new_A->size_c; i++)
+        (*basis)->entries[i] = 1;
+    free_vector(crash);
     return new_LP;
 }
 
+// Pivot artificial variables that are still basic (at zero level) after
+// phase one out of the basis of I, on the largest entry of their row among
+// the first size variables. An artificial variable stays basic only if this
+// row is zero, see remove_redundant_rows - not exported
+void drive_out_artificials(LP *I, Vector *basis, int size) {
+    Tableaux *T = build_tableaux(I, basis);
+    int alpha, beta;
+    for (beta = 0; beta < T->size_B; beta++) {
+        if (T->indices_B->entries[beta] < size)
+            continue;
+        int best = -1;
+        double max = PIVOT_TOL;
+        for (alpha = 0; alpha < T->size_N; alpha++) {
+            if (T->indices_N->entries[alpha] < size &&
+                    fabs(ENTRY(T->Q, beta, alpha)) > max) {
+                max = fabs(ENTRY(T->Q, beta, alpha));
+                best = alpha;
+            }
+        }
+        if (best != -1) {
+            swap_basis(basis, T, best, beta);
+            pivot_tableaux(T, basis, best, beta);
+        }
+    }
+    free_tableaux(T);
+}
+
+int remove_redundant_rows(LP *P, const LP *I, const Vector *basis) {
+    Vector *keep = zero_vector(P->A->size_r);
+    unsigned int i, j, removed = 0;
+    for (i = 0; i < keep->size; i++)
+        keep->entries[i] = 1;
+
+    // The artificial variable j is signs_i e_i for its row i
+    for (j = P->A->size_c; j < I->A->size_c; j++) {
+        if (basis->entries[j] == 0)
+            continue;
+        keep->entries[I->A->row_index[I->A->col_start[j]]] = 0;
+        removed++;
+    }
+    if (removed > 0) {
+        sparse_subind_rows(P->A, keep);
+        Vector *new_b = subind_vector(P->b, keep);
+        free_vector(P->b);
+        P->b = new_b;
+    }
+    free_vector(keep);
+    return removed;
+}
+
+int remove_rows_for_basis(LP *P, const Vector *basis) {
+    unsigned int m = P->A->size_r, n = P->A->size_c;
+    unsigned int i, j, k, size_B = 0;
+    if (basis->size != n)
+        return 0;
+    for (j = 0; j < n; j++)
+        size_B += (basis->entries[j] != 0);
+    if (size_B == 0 || size_B >= m)
+        return 0;
+
+    // Find rows on which A_B is nonsingular by elimination with row
+    // pivoting. The others get an artificial variable, as in phase one.
+    Matrix *A_B = sparse_subind_matrix(P->A, basis);
+    Vector *signs = zero_vector(m);
+    for (i = 0; i < m; i++)
+        signs->entries[i] = 1;
+    for (k = 0; k < size_B; k++) {
+        int row = -1;
+        double max = PIVOT_TOL;
+        for (i = 0; i < m; i++) {
+            if (signs->entries[i] != 0 && fabs(ENTRY(A_B, i, k)) > max) {
+                max = fabs(ENTRY(A_B, i, k));
+                row = i;
+            }
+        }
+        if (row == -1) {
+            free_matrix(A_B);
+            free_vector(signs);
+            return 0;
+        }
+        signs->entries[row] = 0;
+        for (i = 0; i < m; i++) {
+            if (signs->entries[i] == 0)
+                continue;
+            double l = ENTRY(A_B, i, k) / ENTRY(A_B, row, k);
+            for (j = k + 1; j < size_B; j++)
+                ENTRY(A_B, i, j) -= l * ENTRY(A_B, row, j);
+        }
+    }
+    free_matrix(A_B);
+
+    LP *I = calloc(1, sizeof(LP));
+    I->A = sparse_append_unit_columns(P->A, signs);
+    I->b = copy_vector(P->b);
+    I->c = zero_vector(I->A->size_c);
+    free_vector(signs);
+    Vector *I_basis = zero_vector(I->A->size_c);
+    for (j = 0; j < I_basis->size; j++)
+        I_basis->entries[j] = (j >= n || basis->entries[j] != 0);
+
+    // The artificial variables left basic by drive_out_artificials belong
+    // to redundant rows if they are zero, otherwise the rows contradict
+    // each other and are left for phase one to find the LP infeasible
+    drive_out_artificials(I, I_basis, n);
+    Matrix *LU = sparse_subind_matrix(I->A, I_basis);
+    Vector *perm = zero_vector(m);
+    Vector *x = copy_vector(I->b);
+    int removed = 0, consistent = (try_LU_decomp(LU, perm) == 0);
+    if (consistent)
+        LU_solve(LU, perm, x);
+    for (j = 0, k = 0; consistent && j < I_basis->size; j++) {
+        if (I_basis->entries[j] == 0)
+            continue;
+        if (j >= n && !is_zero(x->entries[k]))
+            consistent = 0;
+        k++;
+    }
+    if (consistent)
+        removed = remove_redundant_rows(P, I, I_basis);
+    free_matrix(LU);
+    free_vector(perm);
+    free_vector(x);
+    free_vector(I_basis);
+    free_LP(I);
+    return removed;
+}
+
 int find_initial_basis(LP *P, int pivot_rule, Vector* ret) {
     
     // Find initial basis LP I and set initial basis (for I!)
-    LP *I = initial_basis_LP(P);
-    Vector *basis = zero_vector(I->A->size_c);
+    Vector *basis;
+    LP *I = initial_basis_LP(P, &basis);
     unsigned int i;
-    for (i = P->A->size_c; i < I->A->size_c; i++)
-        basis->entries[i] = 1;
+
+    // The crash basis may already be feasible
+    if (I->A->size_c == P->A->size_c) {
+        copy_to_vector(basis, ret);
+        free_LP(I);
+        free_vector(basis);
+        return 0;
+    }
 
     // Find an optimal solution for I
     Vector *sol = zero_vector(I->A->size_c);
     simplex_solve_LP_basis(I, basis, pivot_rule, sol);
-    free_vector(basis); 
 
     // Check if it has nonnegative value
-    if (inner_product(I->c, sol) < 0) {
+    if (inner_product(I->c, sol) < -ZERO_TOL) {
         free_LP(I);
+        free_vector(basis);
         free_vector(sol);
         return 1;
     }
+    free_vector(sol);
 
+    // simplex_solve_LP_basis leaves the optimal basis in basis
+    drive_out_artificials(I, basis, P->A->size_c);
+    remove_redundant_rows(P, I, basis);
     free_LP(I);
 
     // Copy basis
     for (i = 0; i < ret->size; i++)
-        ret->entries[i] = sol->entries[i];
-    free_vector(sol);
+        ret->entries[i] = basis->entries[i];
+    free_vector(basis);
     return 0;
 }
 
 int simplex_solve_LP(LP *P, int pivot_rule, Vector *ret) {
+    Vector *basis = zero_vector(ret->size);
+    int result = simplex_solve_LP_final_basis(P, pivot_rule, basis, ret);
+    free_vector(basis);
+    return result;
+}
+
+int simplex_solve_LP_final_basis(LP *P, int pivot_rule, Vector *final_basis, Vector *ret) {
 
     // Check m <= n
     if (P->A->size_r > P->A->size_c)
@@ -155,7 +666,9 @@ int simplex_solve_LP(LP *P, int pivot_rule, Vector *ret) {
     // Find an initial basis
     Vector *init_basis = zero_vector(ret->size);
 
+    memset(&simplex_stats, 0, sizeof(SimplexStats));
     int init_basis_result = find_initial_basis(P, pivot_rule, init_basis);
+    simplex_stats.phase_one_pivots = simplex_stats.pivots;
 
     // System infeasible
     if (init_basis_result == 1) {
@@ -165,12 +678,48 @@ int simplex_solve_LP(LP *P, int pivot_rule, Vector *ret) {
 
 
     // Solve the LP and return whether it is bounded
-    if (simplex_solve_LP_basis(P, init_basis, pivot_rule, ret) == 0) {
-        free_vector(init_basis);    
-        return SOLVABLE;
-    }
-    else {
-        free_vector(init_basis);
-        return UNBOUNDED;
+    int result = simplex_solve_LP_basis(P, init_basis, pivot_rule, ret);
+    copy_to_vector(init_basis, final_basis);
+    free_vector(init_basis);
+    return (result == 0 ? SOLVABLE : UNBOUNDED);
+}
+
+int check_basis(LP *P, const Vector *basis) {
+    SparseMatrix *A = P->A;
+    unsigned int i, size_B = 0;
+    if (basis->size != A->size_c)
+        return BASIS_INVALID;
+    for (i = 0; i < basis->size; i++)
+        size_B += (basis->entries[i] != 0);
+    if (size_B != A->size_r)
+        return BASIS_INVALID;
+
+    Matrix *LU = sparse_subind_matrix(A, basis);
+    Vector *perm = zero_vector(size_B);
+    Vector *x = copy_vector(P->b);
+    int result = BASIS_INVALID;
+    if (try_LU_decomp(LU, perm) == 0) {
+        LU_solve(LU, perm, x);
+        result = BASIS_FEASIBLE;
+        for (i = 0; i < size_B; i++) {
+            if (x->entries[i] < -simplex_params.harris_tol)
+                result = BASIS_INFEASIBLE;
+        }
     }
+    free_matrix(LU);
+    free_vector(perm);
+    free_vector(x);
+    return result;
+}
+
+int simplex_solve_LP_warm(LP *P, Vector *basis, int pivot_rule, Vector *ret) {
+    remove_rows_for_basis(P, basis);
+    if (check_basis(P, basis) != BASIS_FEASIBLE)
+        return simplex_solve_LP_final_basis(P, pivot_rule, basis, ret);
+
+    // Skip phase one
+    memset(&simplex_stats, 0, sizeof(SimplexStats));
+    if (simplex_solve_LP_basis(P, basis, pivot_rule, ret) == 0)
+        return SOLVABLE;
+    return UNBOUNDED;
 }
\ No newline at end of file